@@ -0,0 +1,125 @@
+#include "Simulation.hpp"
+#include "CountingEquation.hpp"
+#include "json.hpp"
+
+#include <chrono>
+
+
+
+using TypeForCoords = double;
+
+
+struct BenchmarkResult
+{
+	std::size_t Steps;
+	double NsPerStep;
+	double DerivativeCallsPerStep;
+	double JacobianCallsPerStep;
+};
+
+
+template <typename Equation>
+BenchmarkResult benchmarkSolver(Solvers Method, const Equation &Model, TimeRange<TypeForCoords> Range, unsigned Repeats);
+nlohmann::json runBenchmark(unsigned Repeats);
+
+
+
+
+/**
+ * @brief Benchmark - measures the cost of a step of every Solvers x Models combination for several steps and lengths of the run.
+ *                    Usage: Benchmark [Output.json] [Repeats]. The results are printed as JSON to the Output.json or to stdout.
+ */
+int main(const int argc, const char *argv[])
+{
+	unsigned Repeats = (argc > 2) ? std::stoul(argv[2]) : 3;
+	if (Repeats == 0)
+		throw std::logic_error("Number of repeats can't be zero");
+
+	nlohmann::json Results = runBenchmark(Repeats);
+	if (argc > 1)
+	{
+		std::ofstream Output(argv[1]);
+		if (!Output.is_open())
+			throw std::logic_error("Can't open file " + std::string(argv[1]));
+		Output << Results.dump(2) << "\n";
+	}
+	else
+		std::cout << Results.dump(2) << "\n";
+	return 0;
+}
+
+
+
+
+nlohmann::json runBenchmark(unsigned Repeats)
+{
+	const std::vector<TypeForCoords> Steps     = {1e-2, 1e-3};
+	const std::vector<TypeForCoords> Durations = {10, 100};
+	const ModelParameters<TypeForCoords> Params{5, 0.5, 1, 3};
+
+	// The same force as the hard-coded one, to compare the cost of the compiled expression
+	const ForceExpression<TypeForCoords> Force("F * cos(W0 * t)", getForceParameters(Params, {}));
+
+	nlohmann::json Results = nlohmann::json::array();
+	for (Models Model : magic_enum::enum_values<Models>())
+		for (Solvers Method : magic_enum::enum_values<Solvers>())
+			for (const ForceExpression<TypeForCoords> *Expression : {static_cast<const ForceExpression<TypeForCoords> *>(nullptr), &Force})
+			{
+				// There is no analytical solution of the physical pendulum and of the arbitrary force
+				if ((Model == Models::Phys || Expression) && Method == Solvers::Analitic)
+					continue;
+				if (Expression && Model != Models::MathWithDriv)
+					continue;
+				for (TypeForCoords DeltaT : Steps)
+					for (TypeForCoords Duration : Durations)
+					{
+						TimeRange<TypeForCoords> Range(0, Duration, DeltaT);
+						BenchmarkResult Result{};
+						visitModel(Model, Params, [&](const auto &Equation) { Result = benchmarkSolver(Method, Equation, Range, Repeats); }, Expression);
+						nlohmann::json Row = {{"Solver", magic_enum::enum_name(Method)}, {"Model", magic_enum::enum_name(Model)},
+						                      {"DeltaT", DeltaT}, {"Duration", Duration}, {"Steps", Result.Steps},
+						                      {"NsPerStep", Result.NsPerStep}, {"StepsPerSecond", 1e9 / Result.NsPerStep},
+						                      {"DerivativeCallsPerStep", Result.DerivativeCallsPerStep},
+						                      {"JacobianCallsPerStep", Result.JacobianCallsPerStep}};
+						if (Expression)
+							Row["Force"] = Expression->getText();
+						Results.push_back(Row);
+					}
+			}
+	return nlohmann::json{{"Repeats", Repeats}, {"Results", Results}};
+}
+
+/**
+ * @brief benchmarkSolver - the time is the best of Repeats runs with the bare Model,
+ *                          the calls are counted in a separate run, so the counters don't slow down the timed loop
+ */
+template <typename Equation>
+BenchmarkResult benchmarkSolver(Solvers Method, const Equation &Model, TimeRange<TypeForCoords> Range, unsigned Repeats)
+{
+	const Coordinates<TypeForCoords, 3> StartCoords{0, 1, 0};
+	BenchmarkResult Result{0, std::numeric_limits<double>::max(), 0, 0};
+
+	visitSolver(Method, Model, Range.DeltaT, Tolerance<TypeForCoords>(), [&](Solver<TypeForCoords, 3> &Solver)
+	            {
+	            	for (unsigned i = 0; i < Repeats; ++i)
+	            	{
+	            		NullSink<TypeForCoords, 3> Sink;
+	            		auto Begin = std::chrono::steady_clock::now();
+	            		Solver.streamTrajectory(StartCoords, Range, Sink);
+	            		auto End = std::chrono::steady_clock::now();
+	            		Result.Steps = std::max<std::size_t>(Sink.getCount(), 1);
+	            		double Ns = std::chrono::duration<double, std::nano>(End - Begin).count();
+	            		Result.NsPerStep = std::min(Result.NsPerStep, Ns / Result.Steps);
+	            	}
+	            });
+
+	CountingEquation<TypeForCoords, 3, Equation> CountingModel(Model);
+	visitSolver(Method, CountingModel, Range.DeltaT, Tolerance<TypeForCoords>(), [&](Solver<TypeForCoords, 3> &Solver)
+	            {
+	            	NullSink<TypeForCoords, 3> Sink;
+	            	Solver.streamTrajectory(StartCoords, Range, Sink);
+	            });
+	Result.DerivativeCallsPerStep = double(CountingModel.getDerivativeCalls()) / Result.Steps;
+	Result.JacobianCallsPerStep   = double(CountingModel.getJacobianCalls()) / Result.Steps;
+	return Result;
+}
@@ -31,15 +31,77 @@ def buildSimulator():
 def startSimulator(Cfg):
     sub.run(["../build/Simulator", Cfg])
 
+HeaderTypes = np.dtype([('Magic', 'S8'), ('Version', '<u4'), ('ScalarSize', '<u4'), ('Dim', '<u4'), ('Uniform', '<u4'),
+                        ('Model', 'S32'), ('Solver', 'S32'), 
+                        ('W', '<f8'), ('G', '<f8'), ('F', '<f8'), ('W0', '<f8'),
+                        ('Start', '<f8'), ('Stop', '<f8'), ('DeltaT', '<f8'),
+                        ('RecordCount', '<u8'), ('DataOffset', '<u8'), ('IndexOffset', '<u8'), 
+                        ('IndexCount', '<u8'), ('IndexStride', '<u8'), ('Reserved', 'V72')])
+IndexTypes = np.dtype([('T', '<f8'), ('Record', '<u8')])
+
+def getHeader(FileName):
+    Header = np.fromfile(FileName, dtype=HeaderTypes, count=1)[0]
+    if Header['Magic'] != b'HSIMTRJ' or Header['Version'] != 1:
+        raise ValueError(FileName + " is not a trajectory file")
+    return Header
+
+def mapRecords(FileName, FieldNames):
+    # Records are mapped without copying, so huge runs can be sliced without loading them
+    Header = getHeader(FileName)
+    if Header['Dim'] != len(FieldNames):
+        raise ValueError(FileName + " has records of another dimension")
+    Scalar = {4: '<f4', 8: '<f8'}[int(Header['ScalarSize'])]
+    RecordTypes = np.dtype([(Name, Scalar) for Name in FieldNames])
+    if Header['RecordCount'] == 0:
+        return np.zeros(0, dtype=RecordTypes)
+    return np.memmap(FileName, dtype=RecordTypes, mode='r', offset=int(Header['DataOffset']), shape=(int(Header['RecordCount']),))
+
+def findRecord(FileName, Records, Time):
+    # Number of the last record with time not greater than Time
+    Header = getHeader(FileName)
+    if Header['Uniform']:
+        Record = int((Time - Records['T'][0]) / Header['DeltaT'])
+    else:
+        Index = np.memmap(FileName, dtype=IndexTypes, mode='r', offset=int(Header['IndexOffset']), shape=(int(Header['IndexCount']),))
+        Record = int(Index['Record'][max(np.searchsorted(Index['T'], Time, side='right') - 1, 0)])
+    Record = min(max(Record, 0), len(Records) - 1)
+    while Record > 0 and Records['T'][Record] > Time:
+        Record -= 1
+    while Record + 1 < len(Records) and Records['T'][Record + 1] <= Time:
+        Record += 1
+    return Record
+
 def getTrajectory(FileName):
-    TrajectoryTypes = np.dtype([('T', np.double), ('X', np.double), ('U', np.double)])
-    Trajectory = np.fromfile(FileName, dtype=TrajectoryTypes);
-    return Trajectory
+    return mapRecords(FileName, ['T', 'X', 'U'])
 
 def getEnergy(FileName):
-    EnergyTypes = np.dtype([('T', np.double), ('E', np.double)])
-    Energy = np.fromfile(FileName, dtype=EnergyTypes);
-    return Energy
+    return mapRecords(FileName, ['T', 'E'])
+
+def getObservable(FileName, Name):
+    # Values of the observable Name of the "Observables" list, NameX.bin for X etc.
+    return mapRecords(FileName, ['T', Name])
+
+def getObservableStatistics(FileName):
+    # Count, First, Last, Min, Max, Mean, Rms and Drift of every observable from NameObservables.json
+    with open(FileName) as File:
+        return json.load(File)
+
+def getEvents(FileName):
+    # Event is the index of the event in the "Events" list of the config
+    return mapRecords(FileName, ['T', 'X', 'U', 'Event'])
+
+def getPeriods(Events, Event = 0):
+    # Times between the successive events of the same kind, e.g. the periods for the XZero event with Direction 1
+    Times = Events['T'][Events['Event'] == Event]
+    return np.diff(Times)
+
+def getResponse(FileName):
+    # Steady amplitude A and phase Phi for every frequency W0 of the "Sweep" mode
+    return mapRecords(FileName, ['W0', 'A', 'Phi'])
+
+def showResponse(Response, Gamma, OwnOmega, F, GraphicName):
+    plt.plot(Response['W0'], Response['A'], "o", label = GraphicName + ' A')
+    plt.plot(Response['W0'], getAnalitycalACHH(Gamma, OwnOmega, F, Response['W0']), label = 'Analytical A')
 
 def createGraph(TitleName):
     plt.figure(figsize = (10, 10))
@@ -104,6 +166,17 @@ def main():
         Model = Config["Model"]
         Solver = Config["Solver"]
 
+    if Config.get("Mode") == "Sweep":
+        FullName = Solver + "MathWithDriv"
+        createGraph("ACHH solved by " + Solver)
+        plt.xlabel("W0")
+        plt.ylabel("A")
+        showResponse(getResponse(FullName + "ACHH.bin"), Config["G"], Config["W"], Config["F"], FullName)
+        plt.legend()
+        plt.savefig(FullName + "ACHH.png")
+        sub.run('eog ' + FullName + "ACHH.png", shell=True)
+        return
+
     FullName = Solver + Model
     FileName = FullName + ".bin"
     Trajectory = getTrajectory(FileName)
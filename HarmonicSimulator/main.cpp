@@ -1,75 +1,112 @@
-#include "SolverWithName.hpp"
+#include "Simulation.hpp"
+#include "Sweep.hpp"
 #include "DrivenForce.hpp"
 #include "json.hpp"
 
+#include <set>
+
 
 
-using TypeForCoords = double;
 #define Dim 3
 
 
+enum class Modes
+{
+	Single,
+	Ensemble,
+	Sweep,
+	Jobs
+};
+
+
 std::string getConfigName(const int argc, const char *argv[]);
-void getStartConditionsFromConfigFile(const std::string ConfigFileName, double &W, double &G, double &F, double &W0, Coordinates<TypeForCoords, Dim> &StartCoords, TimeRange<TypeForCoords> &Range, std::string &Model, std::string &Solver);
-void writeSolutionAndEnergyForMethod(Solvers Solver, DiffEquation<TypeForCoords, Dim> &Equation, 
-	                                     Coordinates<TypeForCoords, Dim> &StartCoords, TimeRange<TypeForCoords> &Range);
+template <typename T>
+SimulationJob<T> getJobFromConfig(const nlohmann::json &Job, const nlohmann::json &Defaults);
+template <typename T>
+std::vector<EventCondition<T>> getEventsFromConfig(const nlohmann::json &Events);
+std::vector<Observables> getObservablesFromConfig(const nlohmann::json &Names);
+Modes getModeFromConfigFile(const std::string ConfigFileName);
+Precisions getPrecisionFromConfig(const nlohmann::json &Config);
+template <typename T, typename Stored>
+int runConfig(const std::string ConfigFileName, const nlohmann::json &Config, Modes Mode);
+template <typename T, typename Stored>
+void writeJobsSolutions(const std::string ConfigFileName);
+template <typename T, typename Stored>
+void writeEnsembleSolution(const std::string ConfigFileName, Models Model, Solvers Solver, const ModelParameters<T> &Params, 
+	                       Coordinates<T, Dim> &StartCoords, TimeRange<T> &Range, bool StartIsState);
+template <typename T, typename Stored>
+void writeSweepResponse(const std::string ConfigFileName, Solvers Solver, const ModelParameters<T> &Params, 
+	                    Coordinates<T, Dim> &StartCoords, TimeRange<T> &Range);
 
 
 
 
 int main(const int argc, const char *argv[])
 {
-	double W, G, F, W0;
-	TimeRange<TypeForCoords> Range;
-	Coordinates<TypeForCoords, Dim> StartCoords;
-	std::string ModelStr, SolverStr;
-
 	const std::string ConfigFileName = getConfigName(argc, argv);
-	getStartConditionsFromConfigFile(ConfigFileName, W, G, F, W0, StartCoords, Range, ModelStr, SolverStr);
-
-	//---------------Create_Equations------------------------------------
+	std::ifstream ConfigFile(ConfigFileName);
+	nlohmann::json Config = nlohmann::json::parse(ConfigFile);
 
-	auto Model = magic_enum::enum_cast<Models>(ModelStr);
-	if (!Model.has_value())
+	Modes Mode = getModeFromConfigFile(ConfigFileName);
+	Precisions Precision;
+	try
 	{
-		std::cout << "We dont know this Model: " << ModelStr << "\n";
-		return 0;
+		Precision = getPrecisionFromConfig(Config);
 	}
-	auto Solver = magic_enum::enum_cast<Solvers>(SolverStr);
-	if (!Solver.has_value())
+	catch (const std::logic_error &Error)
 	{
-		std::cout << "We dont know this Solver: " << SolverStr << "\n";
+		std::cout << Error.what() << "\n";
 		return 0;
 	}
 
-	switch (Model.value())
+	switch (Precision)
 	{
-		case Models::Math:
-		{
-			HarmonicEquation<TypeForCoords> MathOscilliator(W);
-			writeSolutionAndEnergyForMethod(Solver.value(), MathOscilliator, StartCoords, Range);
-			break;
-		}
-		case Models::Phys:
-		{
-			PhysOscillEquation<TypeForCoords> PhysOscilliator(W);
-			writeSolutionAndEnergyForMethod(Solver.value(), PhysOscilliator, StartCoords, Range);
-			break;
-		}
-		case Models::MathWithFric:
-		{
-			HarmonicEquationWithFriction<TypeForCoords> MathWithFriction(W, G);
-			writeSolutionAndEnergyForMethod(Solver.value(), MathWithFriction, StartCoords, Range);
+		case Precisions::Float:
+			return runConfig<float, float>(ConfigFileName, Config, Mode);
+		case Precisions::Mixed:
+			return runConfig<double, float>(ConfigFileName, Config, Mode);
+		case Precisions::Double:
 			break;
-		}
-		case Models::MathWithDriv:
+	}
+	return runConfig<double, double>(ConfigFileName, Config, Mode);
+}
+
+/**
+ * @brief runConfig - runs the Mode of the config calculating in T and writing the records as Stored
+ */
+template <typename T, typename Stored>
+int runConfig(const std::string ConfigFileName, const nlohmann::json &Config, Modes Mode)
+{
+	SimulationJob<T> Job;
+	try
+	{
+		if (Mode == Modes::Jobs)
 		{
-			auto DrivenForceLambda = [](TypeForCoords F, TypeForCoords W0, Coordinates<TypeForCoords, 3> State) -> TypeForCoords { return F * cos(W0 * State[0]); };
-			auto Force = DrivenForce<TypeForCoords>(F, W0, DrivenForceLambda);
-			DrivenOscillatorEquation<TypeForCoords> MathWithDriven(W, G, Force);
-			writeSolutionAndEnergyForMethod(Solver.value(), MathWithDriven, StartCoords, Range);
-			break;
+			writeJobsSolutions<T, Stored>(ConfigFileName);
+			return 0;
 		}
+		Job = getJobFromConfig<T>(Config, Config);
+		if (Mode != Modes::Single && !Job.Force.empty())
+			throw std::logic_error("Force is supported only in the Single and Jobs modes");
 	}
+	catch (const std::logic_error &Error)
+	{
+		std::cout << Error.what() << "\n";
+		return 0;
+	}
+
+	if (Mode == Modes::Ensemble)
+	{
+		writeEnsembleSolution<T, Stored>(ConfigFileName, Job.Model, Job.Solver, Job.Params, Job.StartCoords, Job.Range, Job.StartIsState);
+		return 0;
+	}
+	if (Mode == Modes::Sweep)
+	{
+		writeSweepResponse<T, Stored>(ConfigFileName, Job.Solver, Job.Params, Job.StartCoords, Job.Range);
+		return 0;
+	}
+
+	runSimulation<T, Stored>(Job);
 
 	return 0;
 }
@@ -84,60 +121,239 @@ std::string getConfigName(const int argc, const char *argv[])
 	return argv[1];
 }
 
-void getStartConditionsFromConfigFile(const std::string ConfigFileName, double &W, double &G, double &F, double &W0, Coordinates<TypeForCoords, Dim> &StartCoords, TimeRange<TypeForCoords> &Range, std::string &Model, std::string &Solver)
+/**
+ * @brief getJobFromConfig - reads the simulation from the config object Job, 
+ *                           the keys missing in it are taken from Defaults
+ */
+template <typename T>
+SimulationJob<T> getJobFromConfig(const nlohmann::json &Job, const nlohmann::json &Defaults)
+{
+	auto get = [&](const char *Key) -> const nlohmann::json & { return Job.contains(Key) ? Job[Key] : Defaults.at(Key); };
+	auto getOr = [&](const char *Key, auto Value) { return Job.value(Key, Defaults.value(Key, Value)); };
+
+	SimulationJob<T> Simulation;
+	std::string ModelStr = get("Model"), SolverStr = get("Solver");
+	auto Model = magic_enum::enum_cast<Models>(ModelStr);
+	if (!Model.has_value())
+		throw std::logic_error("We dont know this Model: " + ModelStr);
+	auto Solver = magic_enum::enum_cast<Solvers>(SolverStr);
+	if (!Solver.has_value())
+		throw std::logic_error("We dont know this Solver: " + SolverStr);
+	Simulation.Model  = Model.value();
+	Simulation.Solver = Solver.value();
+
+	Simulation.Params = ModelParameters<T>{get("W"), get("G"), get("F"), get("W0")};
+	Simulation.StartCoords[0] = get("T0");
+	Simulation.StartCoords[1] = get("X0");
+	Simulation.StartCoords[2] = get("V0");
+	Simulation.Range.Start  = get("Start");
+	Simulation.Range.Stop   = get("Stop");
+	Simulation.Range.DeltaT = get("Step");
+	// Tolerances are used only by the adaptive solvers
+	Simulation.Tol = Tolerance<T>(getOr("AbsTol", Simulation.Tol.Abs), getOr("RelTol", Simulation.Tol.Rel));
+	// Only every OutputEvery-th state is written to the files
+	Simulation.OutputEvery = getOr("OutputEvery", std::size_t(1));
+	// The states are interpolated to the times OutputStep apart, if it is set
+	Simulation.OutputStep = getOr("OutputStep", T(0));
+	if (Simulation.OutputStep < 0)
+		throw std::logic_error("OutputStep can't be negative");
+	Simulation.StartIsState = getOr("StartIsState", false);
+	Simulation.Compensated  = getOr("Compensated", false);
+	// Checkpoints are written to Name.ckpt
+	Simulation.CheckpointEvery = getOr("CheckpointEvery", std::size_t(0));
+	Simulation.Resume          = getOr("Resume", false);
+	Simulation.Name = Job.value("Name", SolverStr + ModelStr);
+	if (Simulation.OutputStep > 0 && (Simulation.OutputEvery != 1 || Simulation.CheckpointEvery > 0 || Simulation.Resume))
+		throw std::logic_error("OutputStep can't be used together with OutputEvery, CheckpointEvery or Resume");
+	Simulation.Events = getEventsFromConfig<T>(getOr("Events", nlohmann::json::array()));
+	if (!Simulation.Events.empty() && (Simulation.CheckpointEvery > 0 || Simulation.Resume))
+		throw std::logic_error("Events can't be used together with CheckpointEvery or Resume");
+	Simulation.Observables = getObservablesFromConfig(getOr("Observables", nlohmann::json::array()));
+	if (!Simulation.Observables.empty() && (Simulation.CheckpointEvery > 0 || Simulation.Resume))
+		throw std::logic_error("Observables can't be used together with CheckpointEvery or Resume");
+	// The force expression is compiled here only to report its errors before the calculation
+	Simulation.Force           = getOr("Force", std::string());
+	Simulation.ForceParameters = getOr("ForceParameters", std::map<std::string, T>());
+	if (!Simulation.Force.empty())
+	{
+		if (Simulation.Model != Models::MathWithDriv)
+			throw std::logic_error("Force is used only by the " + std::string(magic_enum::enum_name(Models::MathWithDriv)) + " model");
+		if (Simulation.Solver == Solvers::Analitic)
+			throw std::logic_error("Analytical solution is known only for the driving force F cos(W0 t)");
+		ForceExpression<T>(Simulation.Force, getForceParameters(Simulation.Params, Simulation.ForceParameters));
+	}
+	return Simulation;
+}
+
+/**
+ * @brief getEventsFromConfig - reads the list of the events {"Event", "Direction", "TerminateAfter", "Level"},
+ *                              only the "Event" is required
+ */
+template <typename T>
+std::vector<EventCondition<T>> getEventsFromConfig(const nlohmann::json &Events)
+{
+	std::vector<EventCondition<T>> Conditions;
+	for (auto &Event : Events)
+	{
+		std::string EventStr = Event.at("Event");
+		auto Kind = magic_enum::enum_cast<::Events>(EventStr);
+		if (!Kind.has_value())
+			throw std::logic_error("We dont know this Event: " + EventStr);
+		EventCondition<T> Condition;
+		Condition.Event          = Kind.value();
+		Condition.Direction      = Event.value("Direction", 0);
+		Condition.TerminateAfter = Event.value("TerminateAfter", std::size_t(0));
+		Condition.Level          = Event.value("Level", T(0));
+		if (Condition.Direction < -1 || Condition.Direction > 1)
+			throw std::logic_error("Direction of the event must be -1, 0 or 1");
+		Conditions.push_back(Condition);
+	}
+	return Conditions;
+}
+
+/**
+ * @brief getObservablesFromConfig - reads the list of the names of the observables, every one of them may be given once
+ */
+std::vector<Observables> getObservablesFromConfig(const nlohmann::json &Names)
+{
+	std::vector<Observables> List;
+	for (auto &Item : Names)
+	{
+		std::string Name = Item;
+		auto Kind = magic_enum::enum_cast<Observables>(Name);
+		if (!Kind.has_value())
+			throw std::logic_error("We dont know this Observable: " + Name);
+		if (std::find(List.begin(), List.end(), Kind.value()) != List.end())
+			throw std::logic_error("Observable " + Name + " is given twice");
+		List.push_back(Kind.value());
+	}
+	return List;
+}
+
+Modes getModeFromConfigFile(const std::string ConfigFileName)
 {
 	std::ifstream ConfigFile(ConfigFileName);
 	nlohmann::json Config = nlohmann::json::parse(ConfigFile);
 
-	Model = Config["Model"];
-	Solver = Config["Solver"];
-	W = Config["W"];
-	G = Config["G"];
-	F = Config["F"];
-	W0 = Config["W0"];
-	StartCoords[0] = Config["T0"];
-	StartCoords[1] = Config["X0"];
-	StartCoords[2] = Config["V0"];
-	Range.Start = Config["Start"];
-	Range.Stop = Config["Stop"];
-	Range.DeltaT = Config["Step"];
+	std::string ModeStr = Config.value("Mode", std::string(magic_enum::enum_name(Modes::Single)));
+	auto Mode = magic_enum::enum_cast<Modes>(ModeStr);
+	if (!Mode.has_value())
+		throw std::logic_error("We dont know this Mode: " + ModeStr);
+	return Mode.value();
 }
 
-void writeSolutionAndEnergyForMethod(const Solvers Solver, DiffEquation<TypeForCoords, Dim> &Equation, 
-	                                     Coordinates<TypeForCoords, Dim> &StartCoords, TimeRange<TypeForCoords> &Range)
+/**
+ * @brief getPrecisionFromConfig - "Double" by default, "Float" calculates and writes in float,
+ *                                 "Mixed" calculates in double and writes the records in float
+ */
+Precisions getPrecisionFromConfig(const nlohmann::json &Config)
 {
-	const std::string EquationName(Equation.getName());
-	const std::string SolverName(magic_enum::enum_name(Solver));
+	std::string PrecisionStr = Config.value("Precision", std::string(magic_enum::enum_name(Precisions::Double)));
+	auto Precision = magic_enum::enum_cast<Precisions>(PrecisionStr);
+	if (!Precision.has_value())
+		throw std::logic_error("We dont know this Precision: " + PrecisionStr);
+	return Precision.value();
+}
 
-	switch (Solver)
+/**
+ * @brief writeJobsSolutions - runs every simulation of the "Jobs" list in parallel on the ThreadPool of "Threads" threads.
+ *                             Keys missing in an element of the list are taken from the top level of the config,
+ *                             the files of each job are named by its "Name" (SolverModel by default).
+ */
+template <typename T, typename Stored>
+void writeJobsSolutions(const std::string ConfigFileName)
+{
+	std::ifstream ConfigFile(ConfigFileName);
+	nlohmann::json Config = nlohmann::json::parse(ConfigFile);
+
+	std::vector<SimulationJob<T>> Jobs;
+	std::set<std::string> Names;
+	for (auto &Job : Config["Jobs"])
 	{
-		case Solvers::Analitic:
-		{
-			AnalyticalSolver<TypeForCoords, Dim> Analitic(Equation);
-			SolverWithName<TypeForCoords, Dim> AnaliticWithMath(SolverName, EquationName, Analitic);
-			AnaliticWithMath.writeSolutionAndEnergy(StartCoords, Range);
-			break;
-		}
-		case Solvers::Eiler:
-		{
-			EilerSolver<TypeForCoords, Dim> Eiler(Equation, Range.DeltaT);
-			SolverWithName<TypeForCoords, Dim> EilerWithMath(SolverName, EquationName, Eiler);
-			EilerWithMath.writeSolutionAndEnergy(StartCoords, Range);
-			break;
-		}
-		case Solvers::Heun:
-		{
-			HeunSolver<TypeForCoords, Dim> Heun(Equation, Range.DeltaT);
-			SolverWithName<TypeForCoords, Dim> HeunWithMath(SolverName, EquationName, Heun);
-			HeunWithMath.writeSolutionAndEnergy(StartCoords, Range);
-			break;
-		}
-		case Solvers::RungeKutta:
-		{
-			RungeKuttaSolver<TypeForCoords, Dim> RungeKutta(Equation, Range.DeltaT);
-			SolverWithName<TypeForCoords, Dim> RungeKuttaWithMath(SolverName, EquationName, RungeKutta);
-			RungeKuttaWithMath.writeSolutionAndEnergy(StartCoords, Range);
-			break;
-		}
+		if (Job.contains("Precision"))
+			throw std::logic_error("Precision is set for all jobs at the top level of the config");
+		Jobs.push_back(getJobFromConfig<T>(Job, Config));
+		if (!Names.insert(Jobs.back().Name).second)
+			throw std::logic_error("Jobs write the same files " + Jobs.back().Name + ", give them different Name");
+	}
+
+	ThreadPool Pool(Config.value("Threads", std::thread::hardware_concurrency()));
+	std::size_t Failed = runSimulations<T, Stored>(Jobs, Pool);
+	if (Failed > 0)
+		std::cout << Failed << " of " << Jobs.size() << " jobs failed\n";
+}
+
+/**
+ * @brief writeEnsembleSolution - integrates every oscillator of the "Ensemble" list in one EnsembleSolver
+ *                                and writes their final states to SolverModelEnsemble.bin.
+ *                                Parameters missing in an element of the list are taken from the top level of the config.
+ */
+template <typename T, typename Stored>
+void writeEnsembleSolution(const std::string ConfigFileName, Models Model, Solvers Solver, const ModelParameters<T> &Params, 
+	                       Coordinates<T, Dim> &StartCoords, TimeRange<T> &Range, bool StartIsState)
+{
+	std::ifstream ConfigFile(ConfigFileName);
+	nlohmann::json Config = nlohmann::json::parse(ConfigFile);
+
+	EnsembleSolver<T> Ensemble(Model);
+	Ensemble.reserve(Config["Ensemble"].size());
+	for (auto &Oscillator : Config["Ensemble"])
+	{
+		ModelParameters<T> OscillatorParams{Oscillator.value("W", Params.W), Oscillator.value("G", Params.G), 
+		                                                Oscillator.value("F", Params.F), Oscillator.value("W0", Params.W0)};
+		Coordinates<T, Dim> OscillatorCoords{Oscillator.value("T0", StartCoords[0]), Oscillator.value("X0", StartCoords[1]), 
+		                                                 Oscillator.value("V0", StartCoords[2])};
+		Ensemble.addOscillator(OscillatorParams, OscillatorCoords);
+	}
+
+	Ensemble.calculate(Solver, Range, StartIsState);
+
+	std::string FileSolutionName = std::string(magic_enum::enum_name(Solver)) + std::string(magic_enum::enum_name(Model)) + "Ensemble.bin";
+	TrajectoryFileSink<T, Dim, Stored> FileSolution(FileSolutionName, makeTrajectoryHeader<T, Stored>(Dim, magic_enum::enum_name(Model), 
+	                                                    magic_enum::enum_name(Solver), Params, Range, false));
+	FileSolution.open(Ensemble.size());
+	for (std::size_t Lane = 0; Lane < Ensemble.size(); ++Lane)
+		FileSolution.push(Ensemble.getCoords(Lane));
+	FileSolution.close();
+}
+
+/**
+ * @brief writeSweepResponse - calculates the steady amplitude and phase of the MathWithDriv model for every frequency W0 
+ *                             of the "Sweep" config object (either the list "W0" or the range "From", "To", "Count")
+ *                             and writes the records {W0, A, Phi} to SolverMathWithDrivACHH.bin
+ */
+template <typename T, typename Stored>
+void writeSweepResponse(const std::string ConfigFileName, Solvers Solver, const ModelParameters<T> &Params, 
+	                    Coordinates<T, Dim> &StartCoords, TimeRange<T> &Range)
+{
+	std::ifstream ConfigFile(ConfigFileName);
+	nlohmann::json Config = nlohmann::json::parse(ConfigFile);
+	nlohmann::json &Sweep = Config["Sweep"];
+
+	std::vector<T> Frequencies;
+	if (Sweep.contains("W0"))
+		Frequencies = Sweep["W0"].get<std::vector<T>>();
+	else
+	{
+		T From = Sweep["From"], To = Sweep["To"];
+		unsigned Count = Sweep["Count"];
+		for (unsigned i = 0; i < Count; ++i)
+			Frequencies.push_back(Count > 1 ? From + (To - From) * i / (Count - 1) : From);
+	}
+
+	ResponseSweep<T> ResponseSweep(Params, Solver, Sweep.value("SteadyTol", 1e-3), Sweep.value("SteadyPeriods", 5u));
+	std::vector<SteadyResponse<T>> Response = ResponseSweep.calculate(Frequencies, StartCoords, Range);
+
+	std::string ModelName(magic_enum::enum_name(Models::MathWithDriv));
+	std::string SolverName(magic_enum::enum_name(Solver));
+	TrajectoryFileSink<T, 3, Stored> FileResponse(SolverName + ModelName + "ACHH.bin", 
+	                                              makeTrajectoryHeader<T, Stored>(3, ModelName, SolverName, Params, Range, false));
+	FileResponse.open(Response.size());
+	for (auto &Point : Response)
+	{
+		if (!Point.IsSteady)
+			std::cout << "Oscillations with W0 = " << Point.W0 << " didn't become steady before Stop\n";
+		FileResponse.push(Coordinates<T, 3>{Point.W0, Point.A, Point.Phi});
 	}
+	FileResponse.close();
 }
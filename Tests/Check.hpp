@@ -0,0 +1,36 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+
+#include <iostream>
+
+
+
+
+//---------------------------------------------------Check-------------------------------------------------------------------------
+
+/**
+ * The tests have no dependencies: every test is a program, that reports the failed checks and returns 1, if there were any.
+ */
+inline int Failures = 0;
+
+inline void check(bool Passed, const char *Condition, const char *File, int Line)
+{
+	if (Passed)
+		return;
+	++Failures;
+	std::cerr << File << ':' << Line << ": check failed: " << Condition << std::endl;
+}
+
+#define CHECK(Condition) check(static_cast<bool>(Condition), #Condition, __FILE__, __LINE__)
+
+#define CHECK_THROWS(Expression, Exception)                                         \
+	do                                                                              \
+	{                                                                               \
+		bool Thrown = false;                                                        \
+		try { Expression; } catch (const Exception &) { Thrown = true; }            \
+		check(Thrown, #Expression " throws " #Exception, __FILE__, __LINE__);       \
+	} while (false)
+
+
+#endif // CHECK_H
@@ -0,0 +1,33 @@
+#include <ForceExpression.hpp>
+
+#include "Check.hpp"
+
+#include <string>
+
+
+
+
+// x + 1 * x + 2 * x + ... + N * x, every term adds the constant K
+std::string makeSum(unsigned N)
+{
+	std::string Text = "x";
+	for (unsigned K = 1; K <= N; ++K)
+		Text += " + " + std::to_string(K) + " * x";
+	return Text;
+}
+
+int main()
+{
+	ForceExpression<double> Force("F * cos(W0 * t) - 0.1 * x^3 + max(v, 0)", {{"F", 2.0}, {"W0", 3.0}});
+	CHECK(std::abs(Force({0.5, 2.0, -1.0}) - (2.0 * std::cos(1.5) - 0.8)) < 1e-15);
+
+	// The parameters are constants, the whole expression is calculated at the compilation
+	ForceExpression<double> Constant("2 * pi * F", {{"F", 0.5}});
+	CHECK(Constant.size() == 0);
+	CHECK(Constant({0, 0, 0}) == 2 * M_PI * 0.5);
+
+	// The indexes of the constants are bytes: 250 constants fit, 300 don't
+	CHECK(ForceExpression<double>(makeSum(250))({0, 1, 0}) == 1 + 250 * 251 / 2);
+	CHECK_THROWS(ForceExpression<double>(makeSum(300)), std::logic_error);
+	return Failures ? 1 : 0;
+}
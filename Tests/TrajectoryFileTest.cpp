@@ -0,0 +1,55 @@
+#include <TrajectoryFile.hpp>
+
+#include "Check.hpp"
+
+#include <filesystem>
+#include <string>
+
+
+
+
+/**
+ * @brief writeTrajectory - writes Count states of the uniform trajectory with the step 0.1 to the FileName as the Stored records,
+ *                          the index has an entry for every 4th record
+ */
+template <typename Stored>
+void writeTrajectory(const std::string &FileName, std::size_t Count)
+{
+	TrajectoryHeader Header = makeTrajectoryHeader<double, Stored>(3, "Math", "RungeKutta", ModelParameters<double>{5, 0, 0, 0},
+	                                                                TimeRange<double>(0, Count * 0.1, 0.1), true);
+	TrajectoryFileSink<double, 3, Stored> Sink(FileName, Header, 4);
+	Sink.open(Count);
+	for (std::size_t i = 0; i < Count; ++i)
+		Sink.push(Coordinates<double, 3>{i * 0.1, std::cos(i * 0.1), -std::sin(i * 0.1)});
+	Sink.close();
+}
+
+template <typename Stored>
+void checkTrajectory(std::size_t Count)
+{
+	std::string FileName = (std::filesystem::temp_directory_path() / "TrajectoryFileTest.bin").string();
+	writeTrajectory<Stored>(FileName, Count);
+	{
+		MappedTrajectory<Stored, 3> Trajectory(FileName);
+		CHECK(Trajectory.size() == Count);
+		CHECK(Trajectory.getHeader().IndexOffset % alignof(TrajectoryIndexEntry) == 0);
+		CHECK(Trajectory.getHeader().IndexCount == (Count + 3) / 4);
+		for (std::size_t i = 0; i < Trajectory.size(); ++i)
+		{
+			CHECK(Trajectory[i][0] == Stored(i * 0.1));
+			CHECK(Trajectory[i][1] == Stored(std::cos(i * 0.1)));
+		}
+		CHECK(Trajectory.findRecord(Stored(-1)) == 0);
+		CHECK(Trajectory.findRecord(Stored(0.55)) == 5);
+		CHECK(Trajectory.findRecord(Stored(100)) == Count - 1);
+	}
+	std::filesystem::remove(FileName);
+}
+
+int main()
+{
+	checkTrajectory<double>(7);
+	// The records of 3 floats are 12 bytes, so without the padding the index after 7 of them isn't aligned
+	checkTrajectory<float>(7);
+	return Failures ? 1 : 0;
+}
@@ -0,0 +1,144 @@
+#include "Simulation.hpp"
+#include "CountingEquation.hpp"
+#include "json.hpp"
+
+#include <chrono>
+
+
+
+using TypeForCoords = double;
+
+
+//------------------------------------------------AnalyticErrorSink----------------------------------------------------------------
+
+/**
+ * @brief class AnalyticErrorSink - compares every state with the analytical solution of the Model at the time of the state
+ *                                  and accumulates the maximum and the root mean square of the error |(X, V) - (X*, V*)|
+ */
+template <typename T, typename Equation>
+class AnalyticErrorSink : public TrajectorySink<T, 3>
+{
+	const Equation &Model_;
+	SequenceOfConstants<T, 3> Constants_;
+	T MaxError_ = 0, SumOfSquares_ = 0;
+	std::size_t Count_ = 0;
+
+public:
+	AnalyticErrorSink(const Equation &Model, Coordinates<T, 3> StartCoords) : Model_(Model), Constants_(Model.getConstants(StartCoords)) {};
+
+	void push(const Coordinates<T, 3> &State) override
+	{
+		Coordinates<T, 3> Exact = Model_.getState(State[0], Constants_);
+		T Error = linalg::length(Coordinates<T, 2>{State[1] - Exact[1], State[2] - Exact[2]});
+		MaxError_ = std::max(MaxError_, Error);
+		SumOfSquares_ += Error * Error;
+		++Count_;
+	}
+
+	T getMaxError() const { return MaxError_; }
+	T getRmsError() const { return Count_ ? std::sqrt(SumOfSquares_ / Count_) : 0; }
+	std::size_t getCount() const { return Count_; }
+};
+
+
+struct WorkPrecisionPoint
+{
+	double MaxError;
+	double RmsError;
+	double Seconds;
+	std::size_t Steps;
+	std::size_t DerivativeCalls;
+};
+
+
+template <typename Equation>
+WorkPrecisionPoint measureSolver(Solvers Method, const Equation &Model, TimeRange<TypeForCoords> Range, const Tolerance<TypeForCoords> &Tol);
+nlohmann::json runWorkPrecision();
+
+
+
+
+/**
+ * @brief WorkPrecision - runs every numerical solver over a ladder of steps (of tolerances for the adaptive ones)
+ *                        on the models with the analytical solution and prints the work-precision table as JSON.
+ *                        Usage: WorkPrecision [Output.json]
+ */
+int main(const int argc, const char *argv[])
+{
+	nlohmann::json Table = runWorkPrecision();
+	if (argc > 1)
+	{
+		std::ofstream Output(argv[1]);
+		if (!Output.is_open())
+			throw std::logic_error("Can't open file " + std::string(argv[1]));
+		Output << Table.dump(2) << "\n";
+	}
+	else
+		std::cout << Table.dump(2) << "\n";
+	return 0;
+}
+
+
+
+
+nlohmann::json runWorkPrecision()
+{
+	const Models ModelsWithSolution[] = {Models::Math, Models::MathWithFric, Models::MathWithDriv};
+	const ModelParameters<TypeForCoords> Params{5, 0.5, 1, 3};
+	const TypeForCoords Duration = 10, LargestStep = 0.1, InitialStep = 0.01;
+	const unsigned Rungs = 8;
+
+	nlohmann::json Rows = nlohmann::json::array();
+	for (Models Model : ModelsWithSolution)
+		for (Solvers Method : magic_enum::enum_values<Solvers>())
+		{
+			if (Method == Solvers::Analitic)
+				continue;
+			for (unsigned Rung = 0; Rung < Rungs; ++Rung)
+			{
+				// The fixed step solvers halve the step, the adaptive ones tighten the tolerance
+				bool Adaptive = (Method == Solvers::DormandPrince);
+				TimeRange<TypeForCoords> Range(0, Duration, Adaptive ? InitialStep : LargestStep / (1 << Rung));
+				TypeForCoords Tol = std::pow(TypeForCoords(10), -TypeForCoords(3 + Rung));
+				WorkPrecisionPoint Point{};
+				visitModel(Model, Params, [&](const auto &Equation) { Point = measureSolver(Method, Equation, Range, Tolerance<TypeForCoords>(Tol, Tol)); });
+
+				nlohmann::json Row = {{"Solver", magic_enum::enum_name(Method)}, {"Model", magic_enum::enum_name(Model)},
+				                      {"DeltaT", Range.DeltaT}, {"MaxError", Point.MaxError}, {"RmsError", Point.RmsError},
+				                      {"Seconds", Point.Seconds}, {"Steps", Point.Steps}, {"DerivativeCalls", Point.DerivativeCalls}};
+				if (Adaptive)
+					Row["Tolerance"] = Tol;
+				Rows.push_back(Row);
+			}
+		}
+	return nlohmann::json{{"Duration", Duration}, {"W", Params.W}, {"G", Params.G}, {"F", Params.F}, {"W0", Params.W0}, {"Rows", Rows}};
+}
+
+/**
+ * @brief measureSolver - the time is measured on the bare Model with the states dropped,
+ *                        the errors and the derivative calls are collected in a separate run
+ */
+template <typename Equation>
+WorkPrecisionPoint measureSolver(Solvers Method, const Equation &Model, TimeRange<TypeForCoords> Range, const Tolerance<TypeForCoords> &Tol)
+{
+	const Coordinates<TypeForCoords, 3> StartCoords{0, 1, 0};
+	WorkPrecisionPoint Point{};
+
+	visitSolver(Method, Model, Range.DeltaT, Tol, [&](Solver<TypeForCoords, 3> &Solver)
+	            {
+	            	NullSink<TypeForCoords, 3> Sink;
+	            	auto Begin = std::chrono::steady_clock::now();
+	            	Solver.streamTrajectory(StartCoords, Range, Sink);
+	            	auto End = std::chrono::steady_clock::now();
+	            	Point.Seconds = std::chrono::duration<double>(End - Begin).count();
+	            });
+
+	CountingEquation<TypeForCoords, 3, Equation> CountingModel(Model);
+	AnalyticErrorSink<TypeForCoords, Equation> ErrorSink(Model, StartCoords);
+	visitSolver(Method, CountingModel, Range.DeltaT, Tol, [&](Solver<TypeForCoords, 3> &Solver) { Solver.streamTrajectory(StartCoords, Range, ErrorSink); });
+	Point.MaxError        = ErrorSink.getMaxError();
+	Point.RmsError        = ErrorSink.getRmsError();
+	Point.Steps           = ErrorSink.getCount();
+	Point.DerivativeCalls = CountingModel.getDerivativeCalls();
+	return Point;
+}
@@ -0,0 +1,153 @@
+#ifndef ASYNC_WRITER_H
+#define ASYNC_WRITER_H
+
+
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+
+
+//------------------------------------------------AsyncFileWriter------------------------------------------------------------------
+
+/**
+ * @brief class AsyncFileWriter - binary file writer with two fixed-size buffers.
+ *                                The caller fills the front buffer, a full buffer is handed to the background thread,
+ *                                which writes it to the file with one call, while the caller fills the other buffer.
+ *                                So the integration and the disk I/O overlap.
+ */
+class AsyncFileWriter
+{
+	std::ofstream File_;
+	std::vector<char> Front_, Back_;
+	std::size_t FrontSize_ = 0, BackSize_ = 0;
+
+	std::thread Worker_;
+	std::mutex Mutex_;
+	std::condition_variable Cond_;
+	bool BackReady_ = false;
+	bool Stop_      = false;
+	bool Failed_    = false;
+	bool Closed_    = false;
+
+public:
+	static constexpr std::size_t DefaultBufferSize = 1 << 20;
+
+	AsyncFileWriter(const std::string &FileName, std::size_t BufferSize = DefaultBufferSize,
+	                std::ios::openmode Mode = std::ios::binary | std::ios::trunc) :
+	File_(FileName, Mode | std::ios::binary | std::ios::out), Front_(BufferSize), Back_(BufferSize)
+	{
+		if (!File_.is_open())
+			throw std::logic_error("Can't open file " + FileName);
+		if (BufferSize == 0)
+			throw std::logic_error("Buffer size of the AsyncFileWriter can't be zero");
+		Worker_ = std::thread([this]() { writeBuffers(); });
+	}
+
+	AsyncFileWriter(const AsyncFileWriter &) = delete;
+	AsyncFileWriter &operator=(const AsyncFileWriter &) = delete;
+
+	~AsyncFileWriter()
+	{
+		if (!Closed_)
+			stopWorker();
+	}
+
+	void write(const void *Data, std::size_t Size)
+	{
+		const char *Bytes = static_cast<const char *>(Data);
+		while (Size > 0)
+		{
+			if (FrontSize_ == Front_.size())
+				handOff();
+			std::size_t Chunk = std::min(Size, Front_.size() - FrontSize_);
+			std::memcpy(Front_.data() + FrontSize_, Bytes, Chunk);
+			FrontSize_ += Chunk;
+			Bytes      += Chunk;
+			Size       -= Chunk;
+		}
+	}
+
+	template <typename U>
+	void write(const U &Value) { write(&Value, sizeof(Value)); }
+
+	/**
+	 * @brief flush - waits until everything written so far is passed to the file
+	 */
+	void flush()
+	{
+		if (FrontSize_ > 0)
+			handOff();
+		std::unique_lock<std::mutex> Lock(Mutex_);
+		Cond_.wait(Lock, [this]() { return !BackReady_; });
+		File_.flush();
+		if (Failed_ || !File_)
+			throw std::logic_error("Failed to write the output file");
+	}
+
+	void close()
+	{
+		if (Closed_)
+			return;
+		if (FrontSize_ > 0)
+			handOff();
+		stopWorker();
+		File_.close();
+		if (Failed_ || !File_)
+			throw std::logic_error("Failed to write the output file");
+	}
+
+private:
+	// Passes the front buffer to the worker, waiting while it is still busy with the previous one
+	void handOff()
+	{
+		std::unique_lock<std::mutex> Lock(Mutex_);
+		Cond_.wait(Lock, [this]() { return !BackReady_; });
+		std::swap(Front_, Back_);
+		BackSize_  = FrontSize_;
+		FrontSize_ = 0;
+		BackReady_ = true;
+		Cond_.notify_all();
+	}
+
+	void stopWorker()
+	{
+		{
+			std::lock_guard<std::mutex> Lock(Mutex_);
+			Stop_ = true;
+		}
+		Cond_.notify_all();
+		Worker_.join();
+		Closed_ = true;
+	}
+
+	void writeBuffers()
+	{
+		std::unique_lock<std::mutex> Lock(Mutex_);
+		while (true)
+		{
+			Cond_.wait(Lock, [this]() { return BackReady_ || Stop_; });
+			if (!BackReady_)
+				return;
+
+			// The back buffer belongs to the worker until BackReady_ is reset
+			Lock.unlock();
+			File_.write(Back_.data(), BackSize_);
+			bool Failed = !File_;
+			Lock.lock();
+
+			Failed_    = Failed_ || Failed;
+			BackReady_ = false;
+			Cond_.notify_all();
+		}
+	}
+};
+
+
+#endif // ASYNC_WRITER_H
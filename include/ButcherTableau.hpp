@@ -0,0 +1,282 @@
+#ifndef BUTCHER_TABLEAU_H
+#define BUTCHER_TABLEAU_H
+
+
+#include <limits>
+
+
+
+
+/**
+ * Butcher tableaus of the explicit Runge-Kutta methods for the ExplicitRungeKuttaSolver.
+ *
+ *              The stage i is calculated in the state K0 + DeltaT / Divisor[i] * (A[i][0] D[0] + ... + A[i][i-1] D[i-1]),
+ *              the step is K0 + DeltaT / BDivisor * (B[0] D[0] + ... + B[Stages-1] D[Stages-1]).
+ *              The divisors keep the integer coefficients of the classical methods exact (RK4 is DeltaT / 6 * (D1 + 2 D2 + 2 D3 + D4)),
+ *              the other methods have the divisors 1 and the coefficients as they are. The zero coefficients are skipped at compile time.
+ *              C isn't used by the steps: the equations are autonomous, the time is the first coordinate of the state,
+ *              so the row sums of A play the role of C. It is stored for isConsistent, that checks the rows against it.
+ *              The adaptive methods are used here with the fixed step and their higher order weights.
+ */
+
+//------------------------------------------------EulerTableau-------------------------------------------------------------------
+
+struct EulerTableau
+{
+	static constexpr unsigned Stages = 1, Order = 1;
+	static constexpr double A[Stages][Stages] = {{0}};
+	static constexpr double C[Stages]        = {0};
+	static constexpr double Divisor[Stages]  = {1};
+	static constexpr double B[Stages]        = {1};
+	static constexpr double BDivisor         = 1;
+};
+
+//------------------------------------------------HeunTableau--------------------------------------------------------------------
+
+struct HeunTableau
+{
+	static constexpr unsigned Stages = 2, Order = 2;
+	static constexpr double A[Stages][Stages] = {{0, 0},
+	                                             {1, 0}};
+	static constexpr double C[Stages]        = {0, 1};
+	static constexpr double Divisor[Stages]  = {1, 1};
+	static constexpr double B[Stages]        = {1, 1};
+	static constexpr double BDivisor         = 2;
+};
+
+//-----------------------------------------------MidpointTableau-----------------------------------------------------------------
+
+struct MidpointTableau
+{
+	static constexpr unsigned Stages = 2, Order = 2;
+	static constexpr double A[Stages][Stages] = {{0, 0},
+	                                             {1, 0}};
+	static constexpr double C[Stages]        = {0, 1.0 / 2};
+	static constexpr double Divisor[Stages]  = {1, 2};
+	static constexpr double B[Stages]        = {0, 1};
+	static constexpr double BDivisor         = 1;
+};
+
+//------------------------------------------------RalstonTableau-----------------------------------------------------------------
+
+// The second order method with the minimal error bound
+struct RalstonTableau
+{
+	static constexpr unsigned Stages = 2, Order = 2;
+	static constexpr double A[Stages][Stages] = {{0, 0},
+	                                             {2, 0}};
+	static constexpr double C[Stages]        = {0, 2.0 / 3};
+	static constexpr double Divisor[Stages]  = {1, 3};
+	static constexpr double B[Stages]        = {1, 3};
+	static constexpr double BDivisor         = 4;
+};
+
+//----------------------------------------------RungeKutta4Tableau---------------------------------------------------------------
+
+struct RungeKutta4Tableau
+{
+	static constexpr unsigned Stages = 4, Order = 4;
+	static constexpr double A[Stages][Stages] = {{0, 0, 0, 0},
+	                                             {1, 0, 0, 0},
+	                                             {0, 1, 0, 0},
+	                                             {0, 0, 1, 0}};
+	static constexpr double C[Stages]        = {0, 1.0 / 2, 1.0 / 2, 1};
+	static constexpr double Divisor[Stages]  = {1, 2, 2, 1};
+	static constexpr double B[Stages]        = {1, 2, 2, 1};
+	static constexpr double BDivisor         = 6;
+};
+
+//---------------------------------------------RungeKutta38Tableau---------------------------------------------------------------
+
+// Kutta's 3/8 rule
+struct RungeKutta38Tableau
+{
+	static constexpr unsigned Stages = 4, Order = 4;
+	static constexpr double A[Stages][Stages] = {{ 0,  0, 0, 0},
+	                                             { 1,  0, 0, 0},
+	                                             {-1,  3, 0, 0},
+	                                             { 1, -1, 1, 0}};
+	static constexpr double C[Stages]        = {0, 1.0 / 3, 2.0 / 3, 1};
+	static constexpr double Divisor[Stages]  = {1, 3, 3, 1};
+	static constexpr double B[Stages]        = {1, 3, 3, 1};
+	static constexpr double BDivisor         = 8;
+};
+
+//-----------------------------------------------CashKarpTableau-----------------------------------------------------------------
+
+// The 5th order solution of the Cash-Karp 5(4) pair
+struct CashKarpTableau
+{
+	static constexpr unsigned Stages = 6, Order = 5;
+	static constexpr double A[Stages][Stages] = {{0, 0, 0, 0, 0, 0},
+	                                             {1.0 / 5, 0, 0, 0, 0, 0},
+	                                             {3.0 / 40, 9.0 / 40, 0, 0, 0, 0},
+	                                             {3.0 / 10, -9.0 / 10, 6.0 / 5, 0, 0, 0},
+	                                             {-11.0 / 54, 5.0 / 2, -70.0 / 27, 35.0 / 27, 0, 0},
+	                                             {1631.0 / 55296, 175.0 / 512, 575.0 / 13824, 44275.0 / 110592, 253.0 / 4096, 0}};
+	static constexpr double C[Stages]        = {0, 1.0 / 5, 3.0 / 10, 3.0 / 5, 1, 7.0 / 8};
+	static constexpr double Divisor[Stages]  = {1, 1, 1, 1, 1, 1};
+	static constexpr double B[Stages]        = {37.0 / 378, 0, 250.0 / 621, 125.0 / 594, 0, 512.0 / 1771};
+	static constexpr double BDivisor         = 1;
+};
+
+//---------------------------------------------DormandPrince5Tableau-------------------------------------------------------------
+
+// The 5th order solution of the Dormand-Prince 5(4) pair, the last (FSAL) stage is needed only for the error estimate
+struct DormandPrince5Tableau
+{
+	static constexpr unsigned Stages = 6, Order = 5;
+	static constexpr double A[Stages][Stages] = {{0, 0, 0, 0, 0, 0},
+	                                             {1.0 / 5, 0, 0, 0, 0, 0},
+	                                             {3.0 / 40, 9.0 / 40, 0, 0, 0, 0},
+	                                             {44.0 / 45, -56.0 / 15, 32.0 / 9, 0, 0, 0},
+	                                             {19372.0 / 6561, -25360.0 / 2187, 64448.0 / 6561, -212.0 / 729, 0, 0},
+	                                             {9017.0 / 3168, -355.0 / 33, 46732.0 / 5247, 49.0 / 176, -5103.0 / 18656, 0}};
+	static constexpr double C[Stages]        = {0, 1.0 / 5, 3.0 / 10, 4.0 / 5, 8.0 / 9, 1};
+	static constexpr double Divisor[Stages]  = {1, 1, 1, 1, 1, 1};
+	static constexpr double B[Stages]        = {35.0 / 384, 0, 500.0 / 1113, 125.0 / 192, -2187.0 / 6784, 11.0 / 84};
+	static constexpr double BDivisor         = 1;
+};
+
+//-----------------------------------------------Tsitouras5Tableau---------------------------------------------------------------
+
+// The 5th order solution of the Tsitouras 5(4) pair (Ch. Tsitouras, 2011), the coefficients are given in the decimal form
+struct Tsitouras5Tableau
+{
+	static constexpr unsigned Stages = 6, Order = 5;
+	static constexpr double A[Stages][Stages] = {{0, 0, 0, 0, 0, 0},
+	                                             {0.161, 0, 0, 0, 0, 0},
+	                                             {-0.008480655492356989, 0.335480655492357, 0, 0, 0, 0},
+	                                             {2.897153057105493, -6.359448489975075, 4.3622954328695815, 0, 0, 0},
+	                                             {5.325864828439257, -11.748883564062828, 7.4955393428898365, -0.09249506636175525, 0, 0},
+	                                             {5.86145544294642, -12.92096931784711, 8.159367898576159, -0.071584973281401, -0.028269050394068383, 0}};
+	static constexpr double C[Stages]        = {0, 0.161, 0.327, 0.9, 0.9800255409045097, 1};
+	static constexpr double Divisor[Stages]  = {1, 1, 1, 1, 1, 1};
+	static constexpr double B[Stages]        = {0.09646076681806523, 0.01, 0.4798896504144996, 1.379008574103742, -3.290069515436081, 2.324710524099774};
+	static constexpr double BDivisor         = 1;
+};
+
+//------------------------------------------------Butcher6Tableau----------------------------------------------------------------
+
+// Butcher's 7-stage method of the 6th order
+struct Butcher6Tableau
+{
+	static constexpr unsigned Stages = 7, Order = 6;
+	static constexpr double A[Stages][Stages] = {{0, 0, 0, 0, 0, 0, 0},
+	                                             {1.0 / 3, 0, 0, 0, 0, 0, 0},
+	                                             {0, 2.0 / 3, 0, 0, 0, 0, 0},
+	                                             {1.0 / 12, 1.0 / 3, -1.0 / 12, 0, 0, 0, 0},
+	                                             {-1.0 / 16, 9.0 / 8, -3.0 / 16, -3.0 / 8, 0, 0, 0},
+	                                             {0, 9.0 / 8, -3.0 / 8, -3.0 / 4, 1.0 / 2, 0, 0},
+	                                             {9.0 / 44, -9.0 / 11, 63.0 / 44, 18.0 / 11, 0, -16.0 / 11, 0}};
+	static constexpr double C[Stages]        = {0, 1.0 / 3, 2.0 / 3, 1.0 / 3, 1.0 / 2, 1.0 / 2, 1};
+	static constexpr double Divisor[Stages]  = {1, 1, 1, 1, 1, 1, 1};
+	static constexpr double B[Stages]        = {11.0 / 120, 0, 27.0 / 40, 27.0 / 40, -4.0 / 15, -4.0 / 15, 11.0 / 120};
+	static constexpr double BDivisor         = 1;
+};
+
+//------------------------------------------------Verner6Tableau-----------------------------------------------------------------
+
+// The 6th order solution of Verner's 6(5) pair (DVERK), the 6th stage is needed only for the error estimate and is dropped
+struct Verner6Tableau
+{
+	static constexpr unsigned Stages = 7, Order = 6;
+	static constexpr double A[Stages][Stages] = {{0, 0, 0, 0, 0, 0, 0},
+	                                             {1.0 / 6, 0, 0, 0, 0, 0, 0},
+	                                             {4.0 / 75, 16.0 / 75, 0, 0, 0, 0, 0},
+	                                             {5.0 / 6, -8.0 / 3, 5.0 / 2, 0, 0, 0, 0},
+	                                             {-165.0 / 64, 55.0 / 6, -425.0 / 64, 85.0 / 96, 0, 0, 0},
+	                                             {-8263.0 / 15000, 124.0 / 75, -643.0 / 680, -81.0 / 250, 2484.0 / 10625, 0, 0},
+	                                             {3501.0 / 1720, -300.0 / 43, 297275.0 / 52632, -319.0 / 2322, 24068.0 / 84065, 3850.0 / 26703, 0}};
+	static constexpr double C[Stages]        = {0, 1.0 / 6, 4.0 / 15, 2.0 / 3, 5.0 / 6, 1.0 / 15, 1};
+	static constexpr double Divisor[Stages]  = {1, 1, 1, 1, 1, 1, 1};
+	static constexpr double B[Stages]        = {3.0 / 40, 0, 875.0 / 2244, 23.0 / 72, 264.0 / 1955, 125.0 / 11592, 43.0 / 616};
+	static constexpr double BDivisor         = 1;
+};
+
+//------------------------------------------------Verner7Tableau-----------------------------------------------------------------
+
+// The 7th order solution of Verner's 7(6) pair (J. H. Verner, 2010) in the decimal form, the last stage of the error estimate is dropped
+struct Verner7Tableau
+{
+	static constexpr unsigned Stages = 9, Order = 7;
+	static constexpr double A[Stages][Stages] = {{0, 0, 0, 0, 0, 0, 0, 0, 0},
+	                                             {0.005, 0, 0, 0, 0, 0, 0, 0, 0},
+	                                             {-1.0767901234567903, 1.185679012345679, 0, 0, 0, 0, 0, 0, 0},
+	                                             {0.04083333333333333, 0, 0.1225, 0, 0, 0, 0, 0, 0},
+	                                             {0.6389139236255728, 0, -2.455672638223657, 2.272258714598084, 0, 0, 0, 0, 0},
+	                                             {-2.661577375018757, 0, 10.804513886456137, -8.3539146573962, 0.820487594956657, 0, 0, 0, 0},
+	                                             {6.067741434696772, 0, -24.711273635911088, 20.427517930788895, -1.9061579788166472, 1.006172249242068, 0, 0, 0},
+	                                             {12.054670076253204, 0, -49.75478495046899, 41.142888638604674, -4.461760149974004, 2.042334822239175, -0.09834843665406107, 0, 0},
+	                                             {10.138146522881806, 0, -42.6411360317175, 35.76384003992257, -4.3480228403929075, 2.0098622683770357, 0.3487490460338272, -0.27143900510483127, 0}};
+	static constexpr double C[Stages]        = {0, 0.005, 0.10888888888888888, 0.16333333333333333, 0.4555, 0.6095094489978381, 0.884, 0.925, 1};
+	static constexpr double Divisor[Stages]  = {1, 1, 1, 1, 1, 1, 1, 1, 1};
+	static constexpr double B[Stages]        = {0.047155618486272075, 0, 0, 0.25750564298434153, 0.26216653977412624, 0.15216092656738558, 0.4939969170032485, -0.29430311714032503, 0.08131747232495111};
+	static constexpr double BDivisor         = 1;
+};
+
+//------------------------------------------------Verner8Tableau-----------------------------------------------------------------
+
+// The 8th order solution of Verner's 8(7) pair (J. H. Verner, 2010) in the decimal form, the last stage of the error estimate is dropped
+struct Verner8Tableau
+{
+	static constexpr unsigned Stages = 12, Order = 8;
+	static constexpr double A[Stages][Stages] = {{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+	                                             {0.05, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+	                                             {-0.006993164062500001, 0.1135556640625, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+	                                             {0.0399609375, 0, 0.1198828125, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+	                                             {0.36139756280045765, 0, -1.3415240667004928, 1.3701265039000352, 0, 0, 0, 0, 0, 0, 0, 0},
+	                                             {0.049047202797202816, 0, 0, 0.23509720422144048, 0.18085559298135673, 0, 0, 0, 0, 0, 0, 0},
+	                                             {0.06169289044289043, 0, 0, 0.11236568314640277, -0.03885046071451367, 0.01979188712522046, 0, 0, 0, 0, 0, 0},
+	                                             {-1.7676302402223292, 0, 0, -62.5, -6.061889377376669, 5.6508231982227635, 65.62169641937624, 0, 0, 0, 0, 0},
+	                                             {-1.1809450665549721, 0, 0, -41.50473441114321, -4.434438319103725, 4.260408188586133, 43.75364022446172, 0.00787142548991231, 0, 0, 0, 0},
+	                                             {-1.281405999441487, 0, 0, -45.047139960139866, -4.731362069449576, 4.514967016593808, 47.44909557172985, 0.01059228297111661, -0.0057468422638446166, 0, 0, 0},
+	                                             {-1.724470134262487, 0, 0, -60.92349008483054, -5.95151837622239, 5.556523730698456, 63.98301198033305, 0.014642028250414961, 0.06460408772358203, -0.0793032316900888, 0, 0},
+	                                             {-3.3016226677476204, 0, 0, -118.01127235975964, -10.141422388456524, 9.139311332232541, 123.37594282841188, 4.623244378874201, -3.3832777380681693, 4.527592100324566, -5.82849548581123, 0}};
+	static constexpr double C[Stages]        = {0, 0.05, 0.1065625, 0.15984375, 0.39, 0.465, 0.155, 0.943, 0.9018020417358569, 0.909, 0.94, 1};
+	static constexpr double Divisor[Stages]  = {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
+	static constexpr double B[Stages]        = {0.04427989419007711, 0, 0, 0, 0, 0.3541049391724449, 0.2479692154956438, -15.694202038837116, 25.084064965557857, -31.738367786259435, 22.938283273987686, -0.23613246330715906};
+	static constexpr double BDivisor         = 1;
+};
+
+//------------------------------------------------isConsistent-------------------------------------------------------------------
+
+/**
+ * @brief sumCompensated - the sum of the Values by the Kahan-Babuska-Neumaier summation, so the rounding of the sum
+ *                         doesn't hide the rounding of the coefficients
+ */
+constexpr double sumCompensated(const double *Values, unsigned Size)
+{
+	double Sum = 0, Compensation = 0;
+	for (unsigned i = 0; i < Size; ++i)
+	{
+		double Next = Sum + Values[i];
+		bool SumIsLarger = (Sum < 0 ? -Sum : Sum) >= (Values[i] < 0 ? -Values[i] : Values[i]);
+		Compensation += SumIsLarger ? (Sum - Next) + Values[i] : (Values[i] - Next) + Sum;
+		Sum = Next;
+	}
+	return Sum + Compensation;
+}
+
+/**
+ * @brief isConsistent - B sums to BDivisor and the row i of A sums to C[i] * Divisor[i] within a few roundings of 1.
+ *                       The decimal coefficients rounded one by one may miss it by many roundings, then the method
+ *                       has an error floor, that doesn't decrease with the step.
+ */
+template <typename Tableau>
+constexpr bool isConsistent()
+{
+	constexpr double Tolerance = 4 * std::numeric_limits<double>::epsilon();
+	auto isNear = [Tolerance](double Sum, double Expected, double Divisor)
+	{
+		double Difference = Sum - Expected * Divisor;
+		return (Difference < 0 ? -Difference : Difference) <= Tolerance * Divisor;
+	};
+	for (unsigned i = 0; i < Tableau::Stages; ++i)
+		if (!isNear(sumCompensated(Tableau::A[i], Tableau::Stages), Tableau::C[i], Tableau::Divisor[i]))
+			return false;
+	return isNear(sumCompensated(Tableau::B, Tableau::Stages), 1, Tableau::BDivisor);
+}
+
+
+#endif // BUTCHER_TABLEAU_H
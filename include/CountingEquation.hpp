@@ -0,0 +1,57 @@
+#ifndef COUNTING_EQUATION_H
+#define COUNTING_EQUATION_H
+
+
+#include "DiffEquation.hpp"
+
+
+
+
+//------------------------------------------------CountingEquation-----------------------------------------------------------------
+
+/**
+ * @brief class CountingEquation - forwards all calls to the Equation_ and counts the calls of getDerivative and getJacobian.
+ *                                 It is final too, so the solvers instantiated with it still call the Equation_ statically.
+ *                                 The derivatives calculated inside the getJacobian of the Equation_ are not counted.
+ *                                 The counters are not atomic: one CountingEquation must be used by one thread.
+ */
+template <typename T, unsigned Dim, typename Equation>
+class CountingEquation final : public DiffEquation<T, Dim>
+{
+	const Equation &Equation_;
+	mutable std::size_t DerivativeCalls_ = 0;
+	mutable std::size_t JacobianCalls_   = 0;
+
+public:
+	CountingEquation(const Equation &Model) : DiffEquation<T, Dim>(), Equation_(Model) {};
+	const std::basic_string_view<char> getName() const override { return Equation_.getName(); }
+	ModelParameters<T> getParameters() const override { return Equation_.getParameters(); }
+	std::string getForceKey() const override { return Equation_.getForceKey(); }
+
+	Coordinates<T, Dim> getDerivative(Coordinates<T, Dim> State) const override
+	{
+		++DerivativeCalls_;
+		return Equation_.getDerivative(State);
+	}
+
+	JacobianMatrix<T, Dim> getJacobian(Coordinates<T, Dim> State) const override
+	{
+		++JacobianCalls_;
+		return Equation_.getJacobian(State);
+	}
+
+	T getEnergy(Coordinates<T, Dim> State) const override { return Equation_.getEnergy(State); }
+	Coordinates<T, Dim - 1> getConstants(Coordinates<T, Dim> StartCoords) const override { return Equation_.getConstants(StartCoords); }
+	Coordinates<T, Dim> getState(T Time, Coordinates<T, Dim - 1> Constants) const override { return Equation_.getState(Time, Constants); }
+	void getStates(T Start, T DeltaT, Coordinates<T, Dim - 1> Constants, Coordinates<T, Dim> *States, std::size_t Count) const override
+	{
+		Equation_.getStates(Start, DeltaT, Constants, States, Count);
+	}
+
+	std::size_t getDerivativeCalls() const { return DerivativeCalls_; }
+	std::size_t getJacobianCalls()   const { return JacobianCalls_;   }
+	void resetCounters() { DerivativeCalls_ = JacobianCalls_ = 0; }
+};
+
+
+#endif // COUNTING_EQUATION_H
@@ -6,6 +6,10 @@
 #include "DrivenForce.hpp"
 #include "magic_enum.hpp"
 
+#include <algorithm>
+#include <array>
+#include <limits>
+
 
 enum class Models
 {
@@ -15,6 +19,23 @@ enum class Models
 	MathWithDriv
 };
 
+/**
+ * @brief struct ModelParameters - parameters of the oscillator models: frequency W, attenuation G,
+ *                                 amplitude F and frequency W0 of the driving force.
+ *                                 Each model uses only the parameters it needs.
+ */
+template <typename T>
+struct ModelParameters
+{
+	T W  = 0;
+	T G  = 0;
+	T F  = 0;
+	T W0 = 0;
+};
+
+// Column j is the derivative of getDerivative with respect to State[j]
+template <typename T, unsigned Dim>
+using JacobianMatrix = linalg::mat<T, Dim, Dim>;
 
 //--------------------------------------------------DiffEquation-------------------------------------------------------------------
 
@@ -33,6 +54,100 @@ public:
 	virtual Coordinates<T, Dim - 1> getConstants(Coordinates<T, Dim> StartCoords) const { return Coordinates<T, Dim - 1>(); }
 	virtual Coordinates<T, Dim> getState(T Time, Coordinates<T, Dim - 1> Constants) const { return Coordinates<T, Dim>(); }
 	virtual const std::basic_string_view<char> getName() const { return "BaseModel"; }
+	virtual ModelParameters<T> getParameters() const { return ModelParameters<T>(); }
+	// Identifies the driving force, that isn't described by the parameters, empty if there is no force
+	virtual std::string getForceKey() const { return std::string(); }
+	// Energy of the oscillator in the State: kinetic and potential energy of the unit mass
+	virtual T getEnergy(Coordinates<T, Dim> State) const { return 0; }
+
+	/**
+	 * @brief getStates - States[i] = getState(Start + i DeltaT, Constants) for i < Count,
+	 *                    the equations with the linear analytical solution override it with the TransitionTable
+	 */
+	virtual void getStates(T Start, T DeltaT, Coordinates<T, Dim - 1> Constants, Coordinates<T, Dim> *States, std::size_t Count) const
+	{
+		for (std::size_t i = 0; i < Count; ++i)
+			States[i] = getState(Start + i * DeltaT, Constants);
+	}
+
+	/**
+	 * @brief getJacobian - is calculated by the forward differences of getDerivative,
+	 *                      the equations that know the exact one override it
+	 */
+	virtual JacobianMatrix<T, Dim> getJacobian(Coordinates<T, Dim> State) const
+	{
+		JacobianMatrix<T, Dim> Jacobian;
+		Coordinates<T, Dim> Derivative = getDerivative(State);
+		for (unsigned j = 0; j < Dim; ++j)
+		{
+			T Delta = std::sqrt(std::numeric_limits<T>::epsilon()) * std::max(std::abs(State[j]), T(1));
+			Coordinates<T, Dim> Shifted = State;
+			Shifted[j] += Delta;
+			Jacobian[j] = (getDerivative(Shifted) - Derivative) / Delta;
+		}
+		return Jacobian;
+	}
+};
+
+//------------------------------------------------TransitionTable-----------------------------------------------------------------
+
+/**
+ * @brief class TransitionTable - matrices Phi(j DeltaT), j < Size, of the linear homogeneous Equation with the analytical solution:
+ *                                (X, V)(t + j DeltaT) = Phi(j DeltaT) (X, V)(t) for any t. 
+ *                                The columns of Phi are the analytical solutions started from (1, 0) and (0, 1).
+ *
+ *              Only every Size-th state of the trajectory is calculated by the analytical solution (the anchor),
+ *              the next ones are the products of the exact matrices and the anchor, so the error doesn't accumulate
+ *              and there is no sin, cos or exp in the loop. The matrices are stored by elements for the vectorization.
+ */
+template <typename T>
+class TransitionTable
+{
+public:
+	static constexpr std::size_t Size = 64;
+
+private:
+	std::array<T, Size> XX_, XV_, VX_, VV_;
+
+public:
+	template <typename Equation>
+	TransitionTable(const Equation &Model, T DeltaT)
+	{
+		Coordinates<T, 2> FromX = Model.getConstants(Coordinates<T, 3>{0, 1, 0});
+		Coordinates<T, 2> FromV = Model.getConstants(Coordinates<T, 3>{0, 0, 1});
+		for (std::size_t j = 0; j < Size; ++j)
+		{
+			Coordinates<T, 3> X = Model.getState(j * DeltaT, FromX), V = Model.getState(j * DeltaT, FromV);
+			XX_[j] = X[1];
+			VX_[j] = X[2];
+			XV_[j] = V[1];
+			VV_[j] = V[2];
+		}
+	}
+
+	/**
+	 * @brief fill - States[i] is the state at Start + i DeltaT for i < Count, getAnchor(Time) is the exact state at the Time.
+	 *               With Add the X and V are added to the ones in the States (the solution is the sum of several linear parts)
+	 */
+	template <typename AnchorFunction>
+	void fill(T Start, T DeltaT, std::size_t Count, Coordinates<T, 3> *States, AnchorFunction &&getAnchor, bool Add = false) const
+	{
+		for (std::size_t First = 0; First < Count; First += Size)
+		{
+			Coordinates<T, 3> Anchor = getAnchor(Start + First * DeltaT);
+			T X = Anchor[1], V = Anchor[2];
+			std::size_t Block = std::min(Size, Count - First);
+			Coordinates<T, 3> *BlockStates = States + First;
+			for (std::size_t j = 0; j < Block; ++j)
+			{
+				T Time = Start + (First + j) * DeltaT;
+				Coordinates<T, 3> State{Time, XX_[j] * X + XV_[j] * V, VX_[j] * X + VV_[j] * V};
+				if (Add)
+					State += Coordinates<T, 3>{0, BlockStates[j][1], BlockStates[j][2]};
+				BlockStates[j] = State;
+			}
+		}
+	}
 };
 
 //------------------------------------------------HarmonicEquation----------------------------------------------------------------
@@ -53,13 +168,14 @@ public:
  *              
  */
 template <typename T>
-class HarmonicEquation : public DiffEquation<T, 3>
+class HarmonicEquation final : public DiffEquation<T, 3>
 {
 	T B_;
 
 public:
 	HarmonicEquation(T W) : DiffEquation<T, 3>(), B_(W * W) {};
 	const std::basic_string_view<char> getName() const override { return magic_enum::enum_name(Models::Math); }
+	ModelParameters<T> getParameters() const override { return ModelParameters<T>{W()}; }
 
 	Coordinates<T, 3> getDerivative(Coordinates<T, 3> State) const override
 	{
@@ -68,6 +184,18 @@ public:
 		return Coordinates<T, 3>{1, V, - B_ * X};
 	}
 
+	T getEnergy(Coordinates<T, 3> State) const override
+	{
+		T X = State[1];
+		T V = State[2];
+		return V * V / 2 + B_ * X * X / 2;
+	}
+
+	JacobianMatrix<T, 3> getJacobian(Coordinates<T, 3> State) const override
+	{
+		return JacobianMatrix<T, 3>{{0, 0, 0}, {0, 0, -B_}, {0, 1, 0}};
+	}
+
 	Coordinates<T, 2> getConstants(Coordinates<T, 3> StartCoords) const override
 	{
 		T W = sqrt(B_);
@@ -85,6 +213,12 @@ public:
 		T V = C1 * W * cos(W * Time) - C2 * W * sin(W * Time);
 		return Coordinates<T, 3>{Time, X, V}; 
 	}
+
+	void getStates(T Start, T DeltaT, Coordinates<T, 2> Constants, Coordinates<T, 3> *States, std::size_t Count) const override
+	{
+		TransitionTable<T>(*this, DeltaT).fill(Start, DeltaT, Count, States, [&](T Time) { return getState(Time, Constants); });
+	}
+
 	// Frequency
 	T W() const { return sqrt(B_); };
 };
@@ -107,13 +241,14 @@ public:
  *              
  */
 template <typename T>
-class PhysOscillEquation : public DiffEquation<T, 3>
+class PhysOscillEquation final : public DiffEquation<T, 3>
 {
 	T W_;
 
 public:
 	PhysOscillEquation(T W) : DiffEquation<T, 3>(), W_(W) {};
 	const std::basic_string_view<char> getName() const override { return magic_enum::enum_name(Models::Phys); }
+	ModelParameters<T> getParameters() const override { return ModelParameters<T>{W_}; }
 
 	Coordinates<T, 3> getDerivative(Coordinates<T, 3> State) const override
 	{
@@ -122,6 +257,19 @@ public:
 		return Coordinates<T, 3>{1, V, -W_ * W_ * sin(X)};
 	}
 
+	// The potential energy of the pendulum is W^2 (1 - cos x), not the W^2 x^2 / 2 of the harmonic oscillator
+	T getEnergy(Coordinates<T, 3> State) const override
+	{
+		T X = State[1];
+		T V = State[2];
+		return V * V / 2 + W_ * W_ * (1 - cos(X));
+	}
+
+	JacobianMatrix<T, 3> getJacobian(Coordinates<T, 3> State) const override
+	{
+		return JacobianMatrix<T, 3>{{0, 0, 0}, {0, 0, -W_ * W_ * cos(State[1])}, {0, 1, 0}};
+	}
+
 	// Frequency
 	T W() const { return W_; };
 };
@@ -144,13 +292,14 @@ public:
  *              
  */
 template <typename T>
-class HarmonicEquationWithFriction : public DiffEquation<T, 3>
+class HarmonicEquationWithFriction final : public DiffEquation<T, 3>
 {
 	T W_, G_;
 
 public:
 	HarmonicEquationWithFriction(T W, T G) : DiffEquation<T, 3>(), W_(W), G_(G) {};
 	const std::basic_string_view<char> getName() const override { return magic_enum::enum_name(Models::MathWithFric); }
+	ModelParameters<T> getParameters() const override { return ModelParameters<T>{W_, G_}; }
 
 	Coordinates<T, 3> getDerivative(Coordinates<T, 3> State) const override
 	{
@@ -159,6 +308,19 @@ public:
 		return Coordinates<T, 3>{1, V, -2 * G_ * V - W_ * W_ * X};
 	}
 
+	// Energy of the oscillator without the work of the friction, so it decays
+	T getEnergy(Coordinates<T, 3> State) const override
+	{
+		T X = State[1];
+		T V = State[2];
+		return V * V / 2 + W_ * W_ * X * X / 2;
+	}
+
+	JacobianMatrix<T, 3> getJacobian(Coordinates<T, 3> State) const override
+	{
+		return JacobianMatrix<T, 3>{{0, 0, 0}, {0, 0, -W_ * W_}, {0, 1, -2 * G_}};
+	}
+
 	Coordinates<T, 2> getConstants(Coordinates<T, 3> StartCoords) const override
 	{
 		if (G_ > W_)
@@ -235,6 +397,11 @@ public:
 		return Coordinates<T, 3>{Time, X, V}; 
 	}
 
+	void getStates(T Start, T DeltaT, Coordinates<T, 2> Constants, Coordinates<T, 3> *States, std::size_t Count) const override
+	{
+		TransitionTable<T>(*this, DeltaT).fill(Start, DeltaT, Count, States, [&](T Time) { return getState(Time, Constants); });
+	}
+
 	// Frequency
 	T W() const { return W_; };
 	// Attenuation
@@ -259,7 +426,7 @@ public:
  *              
  */
 template <typename T>
-class DrivenOscillatorEquation : public DiffEquation<T, 3>
+class DrivenOscillatorEquation final : public DiffEquation<T, 3>
 {
 	T W_, G_;
 	const DrivenForce<T> &F_;
@@ -268,6 +435,8 @@ class DrivenOscillatorEquation : public DiffEquation<T, 3>
 public:
 	DrivenOscillatorEquation(T W, T G, const DrivenForce<T> &F) : DiffEquation<T, 3>(), W_(W), G_(G), F_(F) {};
 	const std::basic_string_view<char> getName() const override { return magic_enum::enum_name(Models::MathWithDriv); }
+	ModelParameters<T> getParameters() const override { return ModelParameters<T>{W_, G_, F_.getF(), F_.getW()}; }
+	std::string getForceKey() const override { return F_.getKey(); }
 
 	Coordinates<T, 3> getDerivative(Coordinates<T, 3> State) const override
 	{
@@ -276,58 +445,44 @@ public:
 		return Coordinates<T, 3>{1, V, -2 * G_ * V - W_ * W_ * X + F_(State)};
 	}
 
-	Coordinates<T, 3> getState(T Time, Coordinates<T, 2> Constants) const override
+	// Energy of the oscillator without the work of the friction and the driving force
+	T getEnergy(Coordinates<T, 3> State) const override
 	{
-		T X = getX(Time, Constants);
-		T V = getU(Time, Constants);
-		return Coordinates<T, 3>{Time, X, V}; 
+		T X = State[1];
+		T V = State[2];
+		return V * V / 2 + W_ * W_ * X * X / 2;
 	}
 
-    T getX(T Time, Coordinates<T, 2> Constants) const
+	/**
+	 * @brief getState - sum of the free oscillations of the HarmonicEquationWithFriction with the Constants
+	 *                   and the forced oscillations X = A cos(W0 t) + B sin(W0 t) under the force F cos(W0 t)
+	 */
+	Coordinates<T, 3> getState(T Time, Coordinates<T, 2> Constants) const override
 	{
-		T C1 = Constants[0], C2 = Constants[1];
-		T W0 = F_.getW(), F = F_.getF(), W = W_, G = G_, t = Time;
-
-   		T X = C1*exp(t*(-G + sqrt(-G + W)*sqrt(G + W))) 
-   		+ C2*exp(-t*(G + sqrt(-G + W)*sqrt(G + W))) + 2*F*G*W0*sin(W0*t)/(4*pow(G, 2)*pow(W0, 2) 
-   		+ pow(W, 4) - 2*pow(W, 2)*pow(W0, 2) + pow(W0, 4))
-   		+ F*pow(W, 2)*cos(W0*t)/(4*pow(G, 2)*pow(W0, 2) 
-   		+ pow(W, 4) - 2*pow(W, 2)*pow(W0, 2) + pow(W0, 4)) 
-   		- F*pow(W0, 2)*cos(W0*t)/(4*pow(G, 2)*pow(W0, 2) + pow(W, 4) 
-   		- 2*pow(W, 2)*pow(W0, 2) + pow(W0, 4));
-
-   		return X;
+		return HarmonicEquationWithFriction<T>(W_, G_).getState(Time, Constants) + getForcedState(Time);
 	}
 
-    T getU(T Time, Coordinates<T, 2> Constants) const
+	/**
+	 * @brief getStates - the free oscillations are propagated by the TransitionTable of the HarmonicEquationWithFriction,
+	 *                    the forced ones by the table of the HarmonicEquation with the frequency W0 of the force
+	 */
+	void getStates(T Start, T DeltaT, Coordinates<T, 2> Constants, Coordinates<T, 3> *States, std::size_t Count) const override
 	{
-		T C1 = Constants[0], C2 = Constants[1];
-		T W0 = F_.getW(), F = F_.getF(), W = W_, G = G_, t = Time;
-		
-		T U = C1*(-G + sqrt(-G + W)*sqrt(G + W))*exp(t*(-G + sqrt(-G + W)*sqrt(G + W))) 
-		+ C2*(-G - sqrt(-G + W)*sqrt(G + W))*exp(-t*(G + sqrt(-G + W)*sqrt(G + W))) 
-		+ 2*F*G*pow(W0, 2)*cos(W0*t)/(4*pow(G, 2)*pow(W0, 2) + pow(W, 4) - 2*pow(W, 2)*pow(W0, 2) 
-		+ pow(W0, 4)) - F*pow(W, 2)*W0*sin(W0*t)/(4*pow(G, 2)*pow(W0, 2) + pow(W, 4) 
-		- 2*pow(W, 2)*pow(W0, 2) + pow(W0, 4)) + F*pow(W0, 3)*sin(W0*t)/(4*pow(G, 2)*pow(W0, 2) 
-		+ pow(W, 4) - 2*pow(W, 2)*pow(W0, 2) + pow(W0, 4));
-
-		return U;
+		if (F_.getW() == 0)
+			return DiffEquation<T, 3>::getStates(Start, DeltaT, Constants, States, Count);
+		HarmonicEquationWithFriction<T>(W_, G_).getStates(Start, DeltaT, Constants, States, Count);
+		TransitionTable<T>(HarmonicEquation<T>(F_.getW()), DeltaT).fill(Start, DeltaT, Count, States, 
+		                                                               [&](T Time) { return getForcedState(Time); }, true);
 	}
 
+	T getX(T Time, Coordinates<T, 2> Constants) const { return getState(Time, Constants)[1]; }
+	T getU(T Time, Coordinates<T, 2> Constants) const { return getState(Time, Constants)[2]; }
+
 	Coordinates<T, 2> getConstants(Coordinates<T, 3> StartCoords) const override
 	{
-		T X0 = StartCoords[1], U0 = StartCoords[2];
-		T W0 = F_.getW(), F = F_.getF(), W = W_, G = G_;
-
-		T P1 = (-G + sqrt(-G + W)*sqrt(G + W)), P2 = (-G - sqrt(-G + W)*sqrt(G + W));
-		T P3 = F*W*W/(4*G*G*W0*W0 + pow(W, 4) - 2*W*W*W0*W0 + pow(W0, 4)) 
-		- F*W0*W0/(4*G*G*W0*W0 + pow(W, 4) - 2*W*W*W0*W0 + pow(W0, 4));
-		T P4 = 2*F*G*W0*W0/(4*G*G*W0*W0 + pow(W, 4) - 2*W*W*W0*W0 + pow(W0, 4));
-
-		T C2 = (U0 - P1*X0 + P3*P1 - P4) / (P2 - P1);
-	    T C1 = X0 - C2 - P3;
-	    
-		return Coordinates<T, 2>{C1, C2};
+		if (F_.isExpression())
+			throw std::logic_error("Analytical solution is known only for the driving force F cos(W0 t)");
+		return HarmonicEquationWithFriction<T>(W_, G_).getConstants(StartCoords - getForcedState(0));
 	}
 
 	// Frequency
@@ -336,6 +491,17 @@ public:
 	T G() const { return G_; };
 	// Driving force
 	DrivenForce<T> F() const { return F_; };
+
+private:
+	// Forced oscillations without the time component
+	Coordinates<T, 3> getForcedState(T Time) const
+	{
+		T W0 = F_.getW(), F = F_.getF();
+		T Denominator = (W_ * W_ - W0 * W0) * (W_ * W_ - W0 * W0) + 4 * G_ * G_ * W0 * W0;
+		T A = F * (W_ * W_ - W0 * W0) / Denominator;
+		T B = 2 * F * G_ * W0 / Denominator;
+		return Coordinates<T, 3>{0, A * cos(W0 * Time) + B * sin(W0 * Time), W0 * (B * cos(W0 * Time) - A * sin(W0 * Time))};
+	}
 };
 
 
@@ -9,6 +9,8 @@
 #include <sstream>
 #include <linalg.h>
 
+#include "ForceExpression.hpp"
+
 
 
 
@@ -22,19 +24,33 @@ using Coordinates = linalg::vec<T, Dim>;
 
 /**
  * @brief class DrivenForce - class for represent driven force with amplitude F and frequency W. 
- *              
+ *              The force is either the function Func_ or the compiled Expression_, that must outlive the DrivenForce.
  */
 template <typename T>
 class DrivenForce
 {
 	T F_, W_;
-	T (*Func_)(T F, T W, Coordinates<T, 3> State);
+	T (*Func_)(T F, T W, Coordinates<T, 3> State) = nullptr;
+	const ForceExpression<T> *Expression_ = nullptr;
 
 public:
 	DrivenForce(T F, T W, T (*Func)(T F, T W, Coordinates<T, 3> State)) : F_(F), W_(W), Func_(Func) {};
+	DrivenForce(T F, T W, const ForceExpression<T> &Expression) : F_(F), W_(W), Expression_(&Expression) {};
 	T getF() const { return F_; }
 	T getW() const { return W_; }
-	T operator()(Coordinates<T, 3> State) const { return Func_(F_, W_, State); }
+	// The force isn't F cos(W t), so the analytical solution of the driven oscillator is unknown
+	bool isExpression() const { return Expression_ != nullptr; }
+	T operator()(Coordinates<T, 3> State) const { return Expression_ ? (*Expression_)(State) : Func_(F_, W_, State); }
+
+	// Identifies the force apart from F and W: the key of the Expression_ or the address of the Func_
+	std::string getKey() const
+	{
+		if (Expression_)
+			return Expression_->getKey();
+		std::ostringstream Key;
+		Key << "function " << reinterpret_cast<const void *>(Func_);
+		return Key.str();
+	}
 };
 
 
@@ -0,0 +1,215 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+
+#include "Solver.hpp"
+
+
+
+
+//------------------------------------------------EnsembleSolver-------------------------------------------------------------------
+
+/**
+ * @brief class EnsembleSolver - integrates many independent oscillators of the same Model at once.
+ *                               States are stored as a structure of arrays (Time_[], X_[], V_[]),
+ *                               each oscillator (lane) has its own ModelParameters and start coordinates.
+ *                               A step kernel advances all lanes in one loop without dependencies between
+ *                               iterations, so the compiler can vectorize it.
+ *
+ *              All supported models are special cases of
+ *                                 ..     .
+ *                                 x  + 2Gx + W^2 x = F cos(W0 t)        (Math, MathWithFric, MathWithDriv)
+ *                                 ..
+ *                                 x  + W^2 sin x = 0                    (Phys)
+ */
+template <typename T>
+class EnsembleSolver
+{
+	Models Model_;
+
+	// State lanes
+	std::vector<T> Time_, X_, V_;
+	// Parameter lanes: W^2, 2G, F, W0 and the start time of each oscillator
+	std::vector<T> B_, G2_, F_, W0_;
+	std::vector<T> StartTime_;
+	// The lane times are StepStart_ + Steps_ StepSize_ instead of the sums of the steps, 
+	// so the round-off of the time doesn't accumulate (it would shift the phase of the force in float)
+	std::vector<T> StepStart_;
+	std::size_t Steps_ = 0;
+	T StepSize_ = 0;
+
+public:
+	EnsembleSolver(Models Model) : Model_(Model) {};
+
+	std::size_t size() const { return X_.size(); }
+	Models getModel() const { return Model_; }
+
+	void reserve(std::size_t Size)
+	{
+		for (auto *Lane : {&Time_, &X_, &V_, &B_, &G2_, &F_, &W0_, &StartTime_})
+			Lane->reserve(Size);
+	}
+
+	void addOscillator(const ModelParameters<T> &Params, Coordinates<T, 3> StartCoords)
+	{
+		bool HasFriction = (Model_ == Models::MathWithFric) || (Model_ == Models::MathWithDriv);
+		bool HasForce    = (Model_ == Models::MathWithDriv);
+
+		Steps_ = 0;
+		Time_.push_back(StartCoords[0]);
+		X_.push_back(StartCoords[1]);
+		V_.push_back(StartCoords[2]);
+		StartTime_.push_back(StartCoords[0]);
+		B_.push_back(Params.W * Params.W);
+		G2_.push_back(HasFriction ? 2 * Params.G : 0);
+		F_.push_back(HasForce ? Params.F : 0);
+		W0_.push_back(HasForce ? Params.W0 : 0);
+	}
+
+	Coordinates<T, 3> getCoords(std::size_t Lane) const
+	{
+		if (Lane >= size())
+			throw std::logic_error("There is no oscillator with this number in the ensemble");
+		return Coordinates<T, 3>{Time_[Lane], X_[Lane], V_[Lane]};
+	}
+
+	/**
+	 * @brief calculate - advances every lane from its start coordinates through the Range.
+	 *                    As in the single-oscillator solvers, lanes are first integrated for
+	 *                    StartCoords[0] time units (see ExplicitRungeKuttaSolver::getStart), unless StartIsState.
+	 */
+	void calculate(Solvers Method, TimeRange<T> Range, bool StartIsState = false)
+	{
+		if (!StartIsState)
+			warmUp(Method, Range.DeltaT);
+		for (std::size_t i = 0, Count = getStepCount(Range.Start, Range.Stop, Range.DeltaT); i < Count; ++i)
+			step(Method, Range.DeltaT);
+	}
+
+	void step(Solvers Method, T DeltaT)
+	{
+		if (Steps_ == 0 || DeltaT != StepSize_)
+		{
+			StepStart_ = Time_;
+			StepSize_  = DeltaT;
+			Steps_     = 0;
+		}
+		dispatch(Method, [DeltaT](std::size_t) { return DeltaT; });
+		++Steps_;
+		for (std::size_t i = 0; i < size(); ++i)
+			Time_[i] = StepStart_[i] + T(Steps_) * DeltaT;
+	}
+
+	// State lanes for the observers of the ensemble
+	const std::vector<T> &getTime() const { return Time_; }
+	const std::vector<T> &getX()    const { return X_;    }
+	const std::vector<T> &getV()    const { return V_;    }
+
+	/**
+	 * @brief warmUp - lanes have their own start times, so they need different numbers of warm-up steps.
+	 *                 Lanes that are already warmed up take zero-length steps, which keeps the kernel branch-free.
+	 */
+	void warmUp(Solvers Method, T DeltaT)
+	{
+		std::vector<unsigned long> Steps(size());
+		unsigned long MaxSteps = 0;
+		for (std::size_t i = 0; i < size(); ++i)
+		{
+			Steps[i] = getStepCount(T(0), StartTime_[i], DeltaT);
+			MaxSteps = std::max(MaxSteps, Steps[i]);
+		}
+		for (unsigned long k = 0; k < MaxSteps; ++k)
+		{
+			dispatch(Method, [&Steps, k, DeltaT](std::size_t i) { return k < Steps[i] ? DeltaT : T(0); });
+			for (std::size_t i = 0; i < size(); ++i)
+				Time_[i] = StartTime_[i] + T(std::min(k + 1, Steps[i])) * DeltaT;
+		}
+		Steps_ = 0;
+	}
+
+private:
+
+	template <typename StepSize>
+	void dispatch(Solvers Method, StepSize H)
+	{
+		const T *B = B_.data(), *G2 = G2_.data(), *F = F_.data(), *W0 = W0_.data();
+		if (Model_ == Models::Phys)
+			dispatchMethod(Method, H, [B](std::size_t i, T Time, T X, T V) { return -B[i] * std::sin(X); });
+		else if (Model_ == Models::MathWithDriv)
+			dispatchMethod(Method, H, [B, G2, F, W0](std::size_t i, T Time, T X, T V)
+			                          { return -G2[i] * V - B[i] * X + F[i] * std::cos(W0[i] * Time); });
+		else
+			dispatchMethod(Method, H, [B, G2](std::size_t i, T Time, T X, T V) { return -G2[i] * V - B[i] * X; });
+	}
+
+	template <typename StepSize, typename Acceleration>
+	void dispatchMethod(Solvers Method, StepSize H, Acceleration A)
+	{
+		switch (Method)
+		{
+			case Solvers::Eiler:
+				stepEiler(H, A);
+				break;
+			case Solvers::Heun:
+				stepHeun(H, A);
+				break;
+			case Solvers::RungeKutta:
+				stepRungeKutta(H, A);
+				break;
+			default:
+				throw std::logic_error("Ensemble supports only Eiler, Heun and RungeKutta solvers");
+		}
+	}
+
+	template <typename StepSize, typename Acceleration>
+	void stepEiler(StepSize H, Acceleration A)
+	{
+		T *__restrict Time = Time_.data(), *__restrict X = X_.data(), *__restrict V = V_.data();
+		const std::size_t N = size();
+		for (std::size_t i = 0; i < N; ++i)
+		{
+			T DT = H(i), T0 = Time[i], X0 = X[i], V0 = V[i];
+			Time[i] = T0 + DT;
+			X[i]    = X0 + DT * V0;
+			V[i]    = V0 + DT * A(i, T0, X0, V0);
+		}
+	}
+
+	template <typename StepSize, typename Acceleration>
+	void stepHeun(StepSize H, Acceleration A)
+	{
+		T *__restrict Time = Time_.data(), *__restrict X = X_.data(), *__restrict V = V_.data();
+		const std::size_t N = size();
+		for (std::size_t i = 0; i < N; ++i)
+		{
+			T DT = H(i), T0 = Time[i], X0 = X[i], V0 = V[i];
+			T A0 = A(i, T0, X0, V0);
+			T X1 = X0 + DT * V0, V1 = V0 + DT * A0;
+			T A1 = A(i, T0 + DT, X1, V1);
+			Time[i] = T0 + DT;
+			X[i]    = X0 + DT / 2 * (V0 + V1);
+			V[i]    = V0 + DT / 2 * (A0 + A1);
+		}
+	}
+
+	template <typename StepSize, typename Acceleration>
+	void stepRungeKutta(StepSize H, Acceleration A)
+	{
+		T *__restrict Time = Time_.data(), *__restrict X = X_.data(), *__restrict V = V_.data();
+		const std::size_t N = size();
+		for (std::size_t i = 0; i < N; ++i)
+		{
+			T DT = H(i), T0 = Time[i], X0 = X[i], V0 = V[i];
+			T X1 = V0,                 V1 = A(i, T0, X0, V0);
+			T X2 = V0 + DT / 2 * V1,   V2 = A(i, T0 + DT / 2, X0 + DT / 2 * X1, V0 + DT / 2 * V1);
+			T X3 = V0 + DT / 2 * V2,   V3 = A(i, T0 + DT / 2, X0 + DT / 2 * X2, V0 + DT / 2 * V2);
+			T X4 = V0 + DT * V3,       V4 = A(i, T0 + DT, X0 + DT * X3, V0 + DT * V3);
+			Time[i] = T0 + DT;
+			X[i]    = X0 + DT / 6 * (X1 + 2 * X2 + 2 * X3 + X4);
+			V[i]    = V0 + DT / 6 * (V1 + 2 * V2 + 2 * V3 + V4);
+		}
+	}
+};
+
+
+#endif // ENSEMBLE_H
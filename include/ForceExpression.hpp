@@ -0,0 +1,399 @@
+#ifndef FORCE_EXPRESSION_H
+#define FORCE_EXPRESSION_H
+
+
+#include <linalg.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+
+
+//------------------------------------------------ForceExpression------------------------------------------------------------------
+
+/**
+ * @brief class ForceExpression - driving force F(t, x, v) given by a text expression, e.g. "F * cos(W0 * t) - 0.1 * x^3".
+ *
+ *              The expression may use the state t, x, v, the named Parameters, the constants pi and e,
+ *              the operators + - * / ^, the functions sin, cos, tan, asin, acos, atan, sinh, cosh, tanh, exp, log, sqrt, abs
+ *              and pow(a, b), min(a, b), max(a, b).
+ *
+ *              The expression is compiled once into the register bytecode: the registers 0, 1, 2 hold t, x, v,
+ *              the others hold the intermediate results. The parameters are constants, so every subexpression
+ *              without t, x, v is calculated at the compilation and the bytecode has only the operations on the state.
+ */
+template <typename T>
+class ForceExpression
+{
+public:
+	using Parameters = std::map<std::string, T>;
+
+private:
+	enum class OpCode : std::uint8_t
+	{
+		LoadC,
+		AddRR, AddRC,
+		SubRR, SubRC, SubCR,
+		MulRR, MulRC,
+		DivRR, DivRC, DivCR,
+		PowRR, PowRC, PowCR,
+		MinRR, MaxRR,
+		Neg,
+		Sin, Cos, Tan, Asin, Acos, Atan, Sinh, Cosh, Tanh, Exp, Log, Sqrt, Abs
+	};
+
+	// R[Dst] = R[A] op R[B], the operands with C are the indexes of the Constants_
+	struct Instruction
+	{
+		OpCode Op;
+		std::uint8_t Dst, A, B;
+	};
+
+	struct Operand
+	{
+		bool IsConstant;
+		unsigned Index;
+	};
+
+	static constexpr unsigned StateRegisters_ = 3;
+	static constexpr unsigned MaxRegisters_   = 64;
+	// The indexes of the constants are std::uint8_t in the Instruction
+	static constexpr unsigned MaxConstants_   = 256;
+
+	std::string Text_;
+	std::vector<Instruction> Code_;
+	std::vector<T> Constants_;
+	Operand Result_;
+
+	// State of the compilation
+	const Parameters *Parameters_ = nullptr;
+	std::size_t Position_ = 0;
+	unsigned UsedRegisters_ = StateRegisters_;
+
+public:
+	ForceExpression(const std::string &Text, const Parameters &Params = Parameters()) : Text_(Text)
+	{
+		Parameters_ = &Params;
+		Result_ = parseSum();
+		skipSpaces();
+		if (Position_ != Text_.size())
+			fail("unexpected symbol");
+		Parameters_ = nullptr;
+	}
+
+	T operator()(const linalg::vec<T, 3> &State) const
+	{
+		T R[MaxRegisters_];
+		R[0] = State[0];
+		R[1] = State[1];
+		R[2] = State[2];
+		const T *C = Constants_.data();
+		for (const Instruction &I : Code_)
+		{
+			switch (I.Op)
+			{
+				case OpCode::LoadC: R[I.Dst] = C[I.A];                     break;
+				case OpCode::AddRR: R[I.Dst] = R[I.A] + R[I.B];            break;
+				case OpCode::AddRC: R[I.Dst] = R[I.A] + C[I.B];            break;
+				case OpCode::SubRR: R[I.Dst] = R[I.A] - R[I.B];            break;
+				case OpCode::SubRC: R[I.Dst] = R[I.A] - C[I.B];            break;
+				case OpCode::SubCR: R[I.Dst] = C[I.A] - R[I.B];            break;
+				case OpCode::MulRR: R[I.Dst] = R[I.A] * R[I.B];            break;
+				case OpCode::MulRC: R[I.Dst] = R[I.A] * C[I.B];            break;
+				case OpCode::DivRR: R[I.Dst] = R[I.A] / R[I.B];            break;
+				case OpCode::DivRC: R[I.Dst] = R[I.A] / C[I.B];            break;
+				case OpCode::DivCR: R[I.Dst] = C[I.A] / R[I.B];            break;
+				case OpCode::PowRR: R[I.Dst] = std::pow(R[I.A], R[I.B]);   break;
+				case OpCode::PowRC: R[I.Dst] = std::pow(R[I.A], C[I.B]);   break;
+				case OpCode::PowCR: R[I.Dst] = std::pow(C[I.A], R[I.B]);   break;
+				case OpCode::MinRR: R[I.Dst] = std::min(R[I.A], R[I.B]);   break;
+				case OpCode::MaxRR: R[I.Dst] = std::max(R[I.A], R[I.B]);   break;
+				default:            R[I.Dst] = apply(I.Op, R[I.A]);        break;
+			}
+		}
+		return Result_.IsConstant ? C[Result_.Index] : R[Result_.Index];
+	}
+
+	const std::string &getText() const { return Text_; }
+
+	/**
+	 * @brief getKey - the text and the constants, that hold the values of the parameters, so the equal keys are the equal forces
+	 */
+	std::string getKey() const
+	{
+		std::ostringstream Key;
+		Key << std::hexfloat << Text_;
+		for (T Constant : Constants_)
+			Key << ' ' << Constant;
+		return Key.str();
+	}
+	// Number of the bytecode instructions
+	std::size_t size() const { return Code_.size(); }
+
+private:
+	static T apply(OpCode Op, T A)
+	{
+		switch (Op)
+		{
+			case OpCode::Neg:  return -A;
+			case OpCode::Sin:  return std::sin(A);
+			case OpCode::Cos:  return std::cos(A);
+			case OpCode::Tan:  return std::tan(A);
+			case OpCode::Asin: return std::asin(A);
+			case OpCode::Acos: return std::acos(A);
+			case OpCode::Atan: return std::atan(A);
+			case OpCode::Sinh: return std::sinh(A);
+			case OpCode::Cosh: return std::cosh(A);
+			case OpCode::Tanh: return std::tanh(A);
+			case OpCode::Exp:  return std::exp(A);
+			case OpCode::Log:  return std::log(A);
+			case OpCode::Sqrt: return std::sqrt(A);
+			case OpCode::Abs:  return std::abs(A);
+			default:           throw std::logic_error("Unknown operation of the force expression");
+		}
+	}
+
+	static T apply(OpCode Op, T A, T B)
+	{
+		switch (Op)
+		{
+			case OpCode::AddRR: return A + B;
+			case OpCode::SubRR: return A - B;
+			case OpCode::MulRR: return A * B;
+			case OpCode::DivRR: return A / B;
+			case OpCode::PowRR: return std::pow(A, B);
+			case OpCode::MinRR: return std::min(A, B);
+			case OpCode::MaxRR: return std::max(A, B);
+			default:            throw std::logic_error("Unknown operation of the force expression");
+		}
+	}
+
+	//---------------Code_generation------------------------------------
+
+	Operand makeConstant(T Value)
+	{
+		if (Constants_.size() == MaxConstants_)
+			fail("too many constants");
+		Constants_.push_back(Value);
+		return Operand{true, static_cast<unsigned>(Constants_.size() - 1)};
+	}
+
+	// The temporary registers are used as a stack: the operands are always the last allocated ones
+	void release(Operand Value)
+	{
+		if (!Value.IsConstant && Value.Index >= StateRegisters_)
+			--UsedRegisters_;
+	}
+
+	unsigned allocate()
+	{
+		if (UsedRegisters_ == MaxRegisters_)
+			fail("expression is too complex");
+		return UsedRegisters_++;
+	}
+
+	Operand emit(OpCode Op, Operand A, Operand B = Operand{true, 0})
+	{
+		release(B);
+		release(A);
+		unsigned Dst = allocate();
+		Code_.push_back(Instruction{Op, std::uint8_t(Dst), std::uint8_t(A.Index), std::uint8_t(B.Index)});
+		return Operand{false, Dst};
+	}
+
+	Operand toRegister(Operand Value) { return Value.IsConstant ? emit(OpCode::LoadC, Value) : Value; }
+
+	Operand makeUnary(OpCode Op, Operand A)
+	{
+		if (A.IsConstant)
+			return makeConstant(apply(Op, Constants_[A.Index]));
+		return emit(Op, A);
+	}
+
+	/**
+	 * @brief makeBinary - Op is the RR form of the operation, the forms with constants follow it in the OpCode
+	 */
+	Operand makeBinary(OpCode Op, Operand A, Operand B)
+	{
+		if (A.IsConstant && B.IsConstant)
+			return makeConstant(apply(Op, Constants_[A.Index], Constants_[B.Index]));
+		bool Commutative = (Op == OpCode::AddRR || Op == OpCode::MulRR);
+		if (A.IsConstant && Commutative)
+			std::swap(A, B);
+		if (Op == OpCode::MinRR || Op == OpCode::MaxRR)
+		{
+			A = toRegister(A);
+			B = toRegister(B);
+			return emit(Op, A, B);
+		}
+		if (B.IsConstant)
+			return emit(OpCode(std::uint8_t(Op) + 1), A, B);
+		if (A.IsConstant)
+			return emit(OpCode(std::uint8_t(Op) + 2), A, B);
+		return emit(Op, A, B);
+	}
+
+	//---------------Parsing--------------------------------------------
+
+	[[noreturn]] void fail(const std::string &Message) const
+	{
+		throw std::logic_error("Force expression \"" + Text_ + "\": " + Message + " at position " + std::to_string(Position_));
+	}
+
+	void skipSpaces()
+	{
+		while (Position_ < Text_.size() && std::isspace(static_cast<unsigned char>(Text_[Position_])))
+			++Position_;
+	}
+
+	bool accept(char Symbol)
+	{
+		skipSpaces();
+		if (Position_ < Text_.size() && Text_[Position_] == Symbol)
+		{
+			++Position_;
+			return true;
+		}
+		return false;
+	}
+
+	void expect(char Symbol)
+	{
+		if (!accept(Symbol))
+			fail(std::string("expected '") + Symbol + "'");
+	}
+
+	// Sum := Product {(+|-) Product}
+	Operand parseSum()
+	{
+		Operand Result = parseProduct();
+		while (true)
+		{
+			if (accept('+'))
+				Result = makeBinary(OpCode::AddRR, Result, parseProduct());
+			else if (accept('-'))
+				Result = makeBinary(OpCode::SubRR, Result, parseProduct());
+			else
+				return Result;
+		}
+	}
+
+	// Product := Unary {(*|/) Unary}
+	Operand parseProduct()
+	{
+		Operand Result = parseUnary();
+		while (true)
+		{
+			if (accept('*'))
+				Result = makeBinary(OpCode::MulRR, Result, parseUnary());
+			else if (accept('/'))
+				Result = makeBinary(OpCode::DivRR, Result, parseUnary());
+			else
+				return Result;
+		}
+	}
+
+	// Unary := (-|+) Unary | Power
+	Operand parseUnary()
+	{
+		if (accept('-'))
+			return makeUnary(OpCode::Neg, parseUnary());
+		if (accept('+'))
+			return parseUnary();
+		return parsePower();
+	}
+
+	// Power := Primary [^ Unary]
+	Operand parsePower()
+	{
+		Operand Base = parsePrimary();
+		if (accept('^'))
+			return makeBinary(OpCode::PowRR, Base, parseUnary());
+		return Base;
+	}
+
+	// Primary := Number | Name | Function(Sum [, Sum]) | (Sum)
+	Operand parsePrimary()
+	{
+		skipSpaces();
+		if (accept('('))
+		{
+			Operand Result = parseSum();
+			expect(')');
+			return Result;
+		}
+		if (Position_ < Text_.size() && (std::isdigit(static_cast<unsigned char>(Text_[Position_])) || Text_[Position_] == '.'))
+			return parseNumber();
+
+		std::string Name = parseName();
+		if (accept('('))
+			return parseFunction(Name);
+		if (Name == "t" || Name == "x" || Name == "v")
+			return Operand{false, Name == "t" ? 0u : (Name == "x" ? 1u : 2u)};
+		if (auto Parameter = Parameters_->find(Name); Parameter != Parameters_->end())
+			return makeConstant(Parameter->second);
+		if (Name == "pi")
+			return makeConstant(T(M_PI));
+		if (Name == "e")
+			return makeConstant(T(M_E));
+		fail("unknown name '" + Name + "'");
+	}
+
+	Operand parseNumber()
+	{
+		const char *Begin = Text_.c_str() + Position_;
+		char *End = nullptr;
+		double Value = std::strtod(Begin, &End);
+		if (End == Begin)
+			fail("wrong number");
+		Position_ += End - Begin;
+		return makeConstant(T(Value));
+	}
+
+	std::string parseName()
+	{
+		std::size_t Begin = Position_;
+		while (Position_ < Text_.size() && (std::isalnum(static_cast<unsigned char>(Text_[Position_])) || Text_[Position_] == '_'))
+			++Position_;
+		if (Begin == Position_)
+			fail("expected a number or a name");
+		return Text_.substr(Begin, Position_ - Begin);
+	}
+
+	Operand parseFunction(const std::string &Name)
+	{
+		static const std::map<std::string, OpCode> Unary = {
+			{"sin", OpCode::Sin}, {"cos", OpCode::Cos}, {"tan", OpCode::Tan}, {"asin", OpCode::Asin}, {"acos", OpCode::Acos},
+			{"atan", OpCode::Atan}, {"sinh", OpCode::Sinh}, {"cosh", OpCode::Cosh}, {"tanh", OpCode::Tanh}, {"exp", OpCode::Exp},
+			{"log", OpCode::Log}, {"sqrt", OpCode::Sqrt}, {"abs", OpCode::Abs}};
+		static const std::map<std::string, OpCode> Binary = {{"pow", OpCode::PowRR}, {"min", OpCode::MinRR}, {"max", OpCode::MaxRR}};
+
+		if (auto Function = Unary.find(Name); Function != Unary.end())
+		{
+			Operand Argument = parseSum();
+			expect(')');
+			return makeUnary(Function->second, Argument);
+		}
+		if (auto Function = Binary.find(Name); Function != Binary.end())
+		{
+			Operand First = parseSum();
+			expect(',');
+			Operand Second = parseSum();
+			expect(')');
+			return makeBinary(Function->second, First, Second);
+		}
+		fail("unknown function '" + Name + "'");
+	}
+};
+
+
+#endif // FORCE_EXPRESSION_H
@@ -0,0 +1,215 @@
+#ifndef OBSERVABLE_H
+#define OBSERVABLE_H
+
+
+#include "TrajectorySink.hpp"
+
+#include <memory>
+#include <string>
+
+
+
+
+//--------------------------------------------------Observable---------------------------------------------------------------------
+
+/**
+ * @brief class Observable - scalar quantity of the states, that is calculated while the trajectory is streamed.
+ *                           The states come in the order of time, so an observable may depend on the previous ones.
+ */
+template <typename T, unsigned Dim>
+class Observable
+{
+public:
+	virtual ~Observable() {};
+	virtual std::string getName() const = 0;
+	virtual T operator()(const Coordinates<T, Dim> &State) = 0;
+	// Is called before the first state of a trajectory
+	virtual void reset() {}
+};
+
+/**
+ * @brief class EnergyObservable - energy of the state by the getEnergy of its Equation
+ */
+template <typename T, unsigned Dim>
+class EnergyObservable : public Observable<T, Dim>
+{
+	const DiffEquation<T, Dim> &Equation_;
+
+public:
+	EnergyObservable(const DiffEquation<T, Dim> &Equation) : Equation_(Equation) {};
+	std::string getName() const override { return "Energy"; }
+	T operator()(const Coordinates<T, Dim> &State) override { return Equation_.getEnergy(State); }
+};
+
+/**
+ * @brief class CoordinateObservable - the Index-th coordinate of the state
+ */
+template <typename T, unsigned Dim>
+class CoordinateObservable : public Observable<T, Dim>
+{
+	std::string Name_;
+	unsigned Index_;
+
+public:
+	CoordinateObservable(const std::string &Name, unsigned Index) : Name_(Name), Index_(Index)
+	{
+		if (Index_ >= Dim)
+			throw std::logic_error("Observable " + Name + " is out of the state");
+	}
+
+	std::string getName() const override { return Name_; }
+	T operator()(const Coordinates<T, Dim> &State) override { return State[Index_]; }
+};
+
+/**
+ * @brief class PhaseObservable - phase angle of the oscillations with the frequency W, atan2(-V, W X),
+ *                                unwrapped so that it grows continuously by W t for the harmonic oscillator.
+ *                                The states must be less than half a period apart.
+ */
+template <typename T, unsigned Dim>
+class PhaseObservable : public Observable<T, Dim>
+{
+	T W_;
+	bool HasPrevious_ = false;
+	T Previous_ = 0, Phase_ = 0;
+
+public:
+	PhaseObservable(T W) : W_(W)
+	{
+		if (!(W_ > 0))
+			throw std::logic_error("Phase needs a positive frequency W");
+	}
+
+	std::string getName() const override { return "Phase"; }
+
+	T operator()(const Coordinates<T, Dim> &State) override
+	{
+		T Angle = atan2(-State[2], W_ * State[1]);
+		if (HasPrevious_)
+		{
+			T Delta = Angle - Previous_;
+			Delta -= 2 * T(M_PI) * std::round(Delta / (2 * T(M_PI)));
+			Phase_ += Delta;
+		}
+		else
+			Phase_ = Angle;
+		Previous_    = Angle;
+		HasPrevious_ = true;
+		return Phase_;
+	}
+
+	void reset() override { HasPrevious_ = false; }
+};
+
+//-----------------------------------------------RunningStatistics-----------------------------------------------------------------
+
+/**
+ * @brief struct RunningStatistics - statistics of a sequence of values, that are updated by one value at a time.
+ *                                   The sums are taken of the deviations from the First value, so the variance
+ *                                   doesn't lose the precision, when it is small against the mean (e.g. the energy),
+ *                                   and there is no division per value.
+ */
+template <typename T>
+struct RunningStatistics
+{
+	std::size_t Count = 0;
+	T First = 0, Last = 0, Min = 0, Max = 0;
+	// Sums of the deviations from the First value and of their squares
+	T Sum = 0, SumOfSquares = 0;
+
+	void add(T Value)
+	{
+		if (Count == 0)
+			First = Min = Max = Value;
+		Last = Value;
+		Min  = std::min(Min, Value);
+		Max  = std::max(Max, Value);
+		++Count;
+		T Deviation = Value - First;
+		Sum          += Deviation;
+		SumOfSquares += Deviation * Deviation;
+	}
+
+	T getMean() const { return Count > 0 ? First + Sum / Count : 0; }
+
+	T getVariance() const
+	{
+		if (Count == 0)
+			return 0;
+		T Shift = Sum / Count;
+		return std::max(SumOfSquares / Count - Shift * Shift, T(0));
+	}
+
+	T getRms() const { return std::sqrt(getMean() * getMean() + getVariance()); }
+	// Change of the value from the first state to the last one, e.g. the energy error of a solver without friction
+	T getDrift() const { return Last - First; }
+};
+
+//-------------------------------------------------ObservableSink------------------------------------------------------------------
+
+/**
+ * @brief class ObservableSink - calculates the Observables of every state in one pass with the solver.
+ *                               The values of the i-th observable are passed as {Time, Value} to the i-th of the Downstreams
+ *                               (if it isn't nullptr) and, if Accumulate, are accumulated in its RunningStatistics.
+ */
+template <typename T, unsigned Dim>
+class ObservableSink : public TrajectorySink<T, Dim>
+{
+	std::vector<std::unique_ptr<Observable<T, Dim>>> Observables_;
+	std::vector<TrajectorySink<T, 2>*> Downstreams_;
+	std::vector<RunningStatistics<T>> Statistics_;
+	// The statistics cost as much as the observables themselves, so they are calculated only if they are needed
+	bool Accumulate_;
+
+public:
+	ObservableSink(std::vector<std::unique_ptr<Observable<T, Dim>>> Observables, std::vector<TrajectorySink<T, 2>*> Downstreams, 
+	               bool Accumulate = true) :
+	Observables_(std::move(Observables)), Downstreams_(std::move(Downstreams)), Statistics_(Observables_.size()), Accumulate_(Accumulate)
+	{
+		if (Downstreams_.size() != Observables_.size())
+			throw std::logic_error("Every observable must have its downstream sink or nullptr");
+	}
+
+	void open(std::size_t ExpectedStates) override
+	{
+		for (std::size_t i = 0; i < Observables_.size(); ++i)
+		{
+			Observables_[i]->reset();
+			Statistics_[i] = RunningStatistics<T>();
+			if (Downstreams_[i])
+				Downstreams_[i]->open(ExpectedStates);
+		}
+		TrajectorySink<T, Dim>::Done_ = false;
+	}
+
+	void push(const Coordinates<T, Dim> &State) override
+	{
+		bool Done = false;
+		for (std::size_t i = 0; i < Observables_.size(); ++i)
+		{
+			T Value = (*Observables_[i])(State);
+			if (Accumulate_)
+				Statistics_[i].add(Value);
+			if (Downstreams_[i])
+			{
+				Downstreams_[i]->push(Coordinates<T, 2>{State[0], Value});
+				Done = Done || Downstreams_[i]->done();
+			}
+		}
+		TrajectorySink<T, Dim>::Done_ = Done;
+	}
+
+	void close() override
+	{
+		for (TrajectorySink<T, 2> *Downstream : Downstreams_)
+			if (Downstream)
+				Downstream->close();
+	}
+
+	std::size_t size() const { return Observables_.size(); }
+	std::string getName(std::size_t i) const { return Observables_[i]->getName(); }
+	const RunningStatistics<T> &getStatistics(std::size_t i) const { return Statistics_[i]; }
+};
+
+
+#endif // OBSERVABLE_H
@@ -0,0 +1,299 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+
+#include "SolverWithName.hpp"
+#include "ThreadPool.hpp"
+
+
+
+
+/**
+ * @brief enum class Precisions - the scalar types of the calculation and of the output files:
+ *                                Double - double and double, Float - float and float,
+ *                                Mixed - the state is integrated in double, the records are written in float
+ */
+enum class Precisions
+{
+	Double,
+	Float,
+	Mixed
+};
+
+/**
+ * @brief struct SimulationJob - everything needed to calculate one trajectory of one Model with one Solver
+ */
+template <typename T>
+struct SimulationJob
+{
+	Models Model;
+	Solvers Solver;
+	ModelParameters<T> Params;
+	Coordinates<T, 3> StartCoords;
+	TimeRange<T> Range;
+	Tolerance<T> Tol;
+	std::size_t OutputEvery = 1;
+	// If not 0, the states are interpolated to the times OutputStep apart instead of the steps of the solver
+	T OutputStep = 0;
+	// StartCoords is the state at StartCoords[0], not the state integrated for StartCoords[0] time units
+	bool StartIsState = false;
+	// The steps are added to the state by the compensated summation (only the explicit Runge-Kutta solvers)
+	bool Compensated = false;
+	// Checkpoint is written every CheckpointEvery output records (never if 0), 
+	// with Resume the run continues from the checkpoint appending to the files
+	std::size_t CheckpointEvery = 0;
+	bool Resume = false;
+	// Events written to NameEvents.bin
+	std::vector<EventCondition<T>> Events;
+	// Observables written to NameX.bin etc. with their statistics in NameObservables.json
+	std::vector<::Observables> Observables;
+	// Prefix of the output files, SolverModel if empty
+	std::string Name;
+	// Driving force of the MathWithDriv as the ForceExpression of t, x, v, F, W0 and the ForceParameters, F cos(W0 t) if empty
+	std::string Force;
+	std::map<std::string, T> ForceParameters;
+};
+
+/**
+ * @brief visitSolver - creates the Method solver of the Model and passes it to the Visitor.
+ *                      Is instantiated for every concrete (final) equation type,
+ *                      so the solver calls its getDerivative without virtual dispatch.
+ */
+template <typename T, typename Equation, typename Visitor>
+void visitSolver(Solvers Method, const Equation &Model, T DeltaT, const Tolerance<T> &Tol, Visitor &&Visit)
+{
+	switch (Method)
+	{
+		case Solvers::Analitic:
+		{
+			AnalyticalSolver<T, 3, Equation> Analitic(Model);
+			Visit(Analitic);
+			break;
+		}
+		case Solvers::Eiler:
+		{
+			EilerSolver<T, 3, Equation> Eiler(Model, DeltaT);
+			Visit(Eiler);
+			break;
+		}
+		case Solvers::Heun:
+		{
+			HeunSolver<T, 3, Equation> Heun(Model, DeltaT);
+			Visit(Heun);
+			break;
+		}
+		case Solvers::RungeKutta:
+		{
+			RungeKuttaSolver<T, 3, Equation> RungeKutta(Model, DeltaT);
+			Visit(RungeKutta);
+			break;
+		}
+		case Solvers::DormandPrince:
+		{
+			DormandPrinceSolver<T, 3, Equation> DormandPrince(Model, DeltaT, Tol);
+			Visit(DormandPrince);
+			break;
+		}
+		case Solvers::StormerVerlet:
+		{
+			StormerVerletSolver<T, 3, Equation> StormerVerlet(Model, DeltaT);
+			Visit(StormerVerlet);
+			break;
+		}
+		case Solvers::Yoshida4:
+		{
+			Yoshida4Solver<T, 3, Equation> Yoshida4(Model, DeltaT);
+			Visit(Yoshida4);
+			break;
+		}
+		case Solvers::Yoshida6:
+		{
+			Yoshida6Solver<T, 3, Equation> Yoshida6(Model, DeltaT);
+			Visit(Yoshida6);
+			break;
+		}
+		case Solvers::RadauIIA:
+		{
+			RadauIIASolver<T, 3, Equation> RadauIIA(Model, DeltaT);
+			Visit(RadauIIA);
+			break;
+		}
+		case Solvers::Midpoint:
+		{
+			ExplicitRungeKuttaSolver<T, 3, MidpointTableau, Solvers::Midpoint, Equation> Midpoint(Model, DeltaT);
+			Visit(Midpoint);
+			break;
+		}
+		case Solvers::Ralston:
+		{
+			ExplicitRungeKuttaSolver<T, 3, RalstonTableau, Solvers::Ralston, Equation> Ralston(Model, DeltaT);
+			Visit(Ralston);
+			break;
+		}
+		case Solvers::RungeKutta38:
+		{
+			ExplicitRungeKuttaSolver<T, 3, RungeKutta38Tableau, Solvers::RungeKutta38, Equation> RungeKutta38(Model, DeltaT);
+			Visit(RungeKutta38);
+			break;
+		}
+		case Solvers::CashKarp:
+		{
+			ExplicitRungeKuttaSolver<T, 3, CashKarpTableau, Solvers::CashKarp, Equation> CashKarp(Model, DeltaT);
+			Visit(CashKarp);
+			break;
+		}
+		case Solvers::DormandPrince5:
+		{
+			ExplicitRungeKuttaSolver<T, 3, DormandPrince5Tableau, Solvers::DormandPrince5, Equation> DormandPrince5(Model, DeltaT);
+			Visit(DormandPrince5);
+			break;
+		}
+		case Solvers::Tsitouras5:
+		{
+			ExplicitRungeKuttaSolver<T, 3, Tsitouras5Tableau, Solvers::Tsitouras5, Equation> Tsitouras5(Model, DeltaT);
+			Visit(Tsitouras5);
+			break;
+		}
+		case Solvers::Butcher6:
+		{
+			ExplicitRungeKuttaSolver<T, 3, Butcher6Tableau, Solvers::Butcher6, Equation> Butcher6(Model, DeltaT);
+			Visit(Butcher6);
+			break;
+		}
+		case Solvers::Verner6:
+		{
+			ExplicitRungeKuttaSolver<T, 3, Verner6Tableau, Solvers::Verner6, Equation> Verner6(Model, DeltaT);
+			Visit(Verner6);
+			break;
+		}
+		case Solvers::Verner7:
+		{
+			ExplicitRungeKuttaSolver<T, 3, Verner7Tableau, Solvers::Verner7, Equation> Verner7(Model, DeltaT);
+			Visit(Verner7);
+			break;
+		}
+		case Solvers::Verner8:
+		{
+			ExplicitRungeKuttaSolver<T, 3, Verner8Tableau, Solvers::Verner8, Equation> Verner8(Model, DeltaT);
+			Visit(Verner8);
+			break;
+		}
+		case Solvers::AdamsBashforthMoulton:
+		{
+			AdamsBashforthMoultonSolver<T, 3, Equation> AdamsBashforthMoulton(Model, DeltaT);
+			Visit(AdamsBashforthMoulton);
+			break;
+		}
+	}
+}
+
+/**
+ * @brief visitModel - creates the equation of the Model with the Params and passes it to the Visitor
+ */
+template <typename T, typename Visitor>
+void visitModel(Models Model, const ModelParameters<T> &Params, Visitor &&Visit, const ForceExpression<T> *Expression = nullptr)
+{
+	switch (Model)
+	{
+		case Models::Math:
+		{
+			HarmonicEquation<T> MathOscilliator(Params.W);
+			Visit(MathOscilliator);
+			break;
+		}
+		case Models::Phys:
+		{
+			PhysOscillEquation<T> PhysOscilliator(Params.W);
+			Visit(PhysOscilliator);
+			break;
+		}
+		case Models::MathWithFric:
+		{
+			HarmonicEquationWithFriction<T> MathWithFriction(Params.W, Params.G);
+			Visit(MathWithFriction);
+			break;
+		}
+		case Models::MathWithDriv:
+		{
+			auto DrivenForceLambda = [](T F, T W0, Coordinates<T, 3> State) -> T { return F * cos(W0 * State[0]); };
+			auto Force = Expression ? DrivenForce<T>(Params.F, Params.W0, *Expression) : DrivenForce<T>(Params.F, Params.W0, DrivenForceLambda);
+			DrivenOscillatorEquation<T> MathWithDriven(Params.W, Params.G, Force);
+			Visit(MathWithDriven);
+			break;
+		}
+	}
+}
+
+/**
+ * @brief getForceParameters - the names available in the force expression: F, W0, W, G of the Params and the Extra ones
+ */
+template <typename T>
+typename ForceExpression<T>::Parameters getForceParameters(const ModelParameters<T> &Params, const std::map<std::string, T> &Extra)
+{
+	typename ForceExpression<T>::Parameters Names = {{"F", Params.F}, {"W0", Params.W0}, {"W", Params.W}, {"G", Params.G}};
+	for (const auto &[Name, Value] : Extra)
+		if (!Names.emplace(Name, Value).second)
+			throw std::logic_error("Force parameter " + Name + " hides the parameter of the model");
+	return Names;
+}
+
+/**
+ * @brief runSimulation - writes the solution and the energy of the Job, the records are stored as Stored
+ */
+template <typename T, typename Stored = T>
+void runSimulation(const SimulationJob<T> &Job)
+{
+	std::optional<ForceExpression<T>> Expression;
+	if (!Job.Force.empty())
+		Expression.emplace(Job.Force, getForceParameters(Job.Params, Job.ForceParameters));
+
+	visitModel(Job.Model, Job.Params, [&Job](const auto &Model)
+	           {
+	           	const std::string EquationName(Model.getName());
+	           	const std::string SolverName(magic_enum::enum_name(Job.Solver));
+	           	visitSolver(Job.Solver, Model, Job.Range.DeltaT, Job.Tol, [&](Solver<T, 3> &Solver)
+	           	            {
+	           	            	Coordinates<T, 3> StartCoords = Job.StartCoords;
+	           	            	TimeRange<T> Range = Job.Range;
+	           	            	Solver.setStartIsState(Job.StartIsState);
+	           	            	Solver.setCompensated(Job.Compensated);
+	           	            	SolverWithName<T, 3, Stored> SolverWithMath(SolverName, EquationName, Solver, Job.Name);
+	           	            	SolverWithMath.setCheckpoint(Job.CheckpointEvery, Job.Resume);
+	           	            	SolverWithMath.setEvents(Job.Events);
+	           	            	SolverWithMath.setObservables(Job.Observables);
+	           	            	SolverWithMath.writeSolutionAndEnergy(StartCoords, Range, Job.OutputEvery, Job.OutputStep);
+	           	            });
+	           }, Expression ? &*Expression : nullptr);
+}
+
+/**
+ * @brief runSimulations - runs independent Jobs on the Pool, every job writes its own files.
+ *                         A failed job doesn't stop the others, its error is printed.
+ *
+ * @return the number of failed jobs
+ */
+template <typename T, typename Stored = T>
+std::size_t runSimulations(const std::vector<SimulationJob<T>> &Jobs, ThreadPool &Pool)
+{
+	std::mutex OutputMutex;
+	std::atomic<std::size_t> Failed{0};
+	for (const SimulationJob<T> &Job : Jobs)
+		Pool.submit([&Job, &OutputMutex, &Failed]()
+		            {
+		            	try
+		            	{
+		            		runSimulation<T, Stored>(Job);
+		            	}
+		            	catch (const std::exception &Error)
+		            	{
+		            		++Failed;
+		            		std::lock_guard<std::mutex> Lock(OutputMutex);
+		            		std::cout << "Job " << Job.Name << " failed: " << Error.what() << "\n";
+		            	}
+		            });
+	Pool.wait();
+	return Failed;
+}
+
+
+#endif // SIMULATION_H
@@ -2,7 +2,16 @@
 #define SOLVER_H
 
 
+#include "ButcherTableau.hpp"
 #include "DiffEquation.hpp"
+#include "TrajectorySink.hpp"
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <optional>
 
 
 
@@ -11,7 +20,23 @@ enum class Solvers
 	Analitic,
 	Eiler,
 	Heun,
-	RungeKutta
+	RungeKutta,
+	DormandPrince,
+	StormerVerlet,
+	Yoshida4,
+	Yoshida6,
+	RadauIIA,
+	Midpoint,
+	Ralston,
+	RungeKutta38,
+	CashKarp,
+	DormandPrince5,
+	Tsitouras5,
+	Butcher6,
+	Verner6,
+	Verner7,
+	Verner8,
+	AdamsBashforthMoulton
 };
 
 
@@ -39,17 +64,169 @@ struct TimeRange
 	}
 };
 
-template <typename T, unsigned Dim>
-using SequenceOfStates = std::vector<Coordinates<T, Dim>>;
+/**
+ * @brief getStepCount - the number of the times Start + i DeltaT before the Stop.
+ *                       The steps are counted instead of summed, so the round-off of the time doesn't accumulate 
+ *                       and doesn't add or drop the last step.
+ */
+template <typename T>
+std::size_t getStepCount(T Start, T Stop, T DeltaT)
+{
+	if (!(Stop > Start))
+		return 0;
+	// The quotient is rounded, the count is corrected by the times themselves
+	std::size_t Count = std::ceil((Stop - Start) / DeltaT);
+	while (Count > 0 && Start + T(Count - 1) * DeltaT >= Stop)
+		--Count;
+	while (Start + T(Count) * DeltaT < Stop)
+		++Count;
+	return Count;
+}
+
+template <typename T>
+struct Tolerance
+{
+	T Abs;
+	T Rel;
+
+	Tolerance() : Abs(1e-6), Rel(1e-6) {};
+
+	Tolerance(T A, T R) : Abs(A), Rel(R)
+	{
+		if (Abs < 0)
+			throw std::logic_error("Absolute tolerance can't be negative");
+		if (Rel < 0)
+			throw std::logic_error("Relative tolerance can't be negative");
+		if (Abs == 0 && Rel == 0)
+			throw std::logic_error("At least one of the tolerances must be positive");
+	}
+};
 
 template <typename T, unsigned Dim>
 using SequenceOfConstants = Coordinates<T, Dim - 1>;
 
+/**
+ * @brief struct SolverState - state of the integration between two steps: the next state to push, 
+ *                             the time counter of the stepping loop and the next step size.
+ *                             The fixed step solvers count the Steps from the start of the first run:
+ *                             the time of the loop is Start + Steps Step, the time of the state is StateStart + Steps Step.
+ */
+template <typename T, unsigned Dim>
+struct SolverState
+{
+	Coordinates<T, Dim> State;
+	T Time;
+	T Step;
+	T Start = 0, StateStart = 0;
+	std::uint64_t Steps = 0;
+	// Rounding error of the State by the compensated summation
+	Coordinates<T, Dim> Compensation;
+	// Value, that the step carries to the next one (the acceleration of the SplitStepSolver)
+	T Carried = 0;
+};
+
+/**
+ * @brief combineStages - K0 + Step * (A[0] D[0] + ... + A[N-1] D[N-1]), the stage combination of the Runge-Kutta methods.
+ *                        Is always inlined, so the coefficients become constants of the step.
+ */
+template <typename T, int Dim, std::size_t N, std::size_t... I, typename... Stages>
+[[gnu::always_inline]] inline Coordinates<T, Dim> combineStages(const Coordinates<T, Dim> &K0, T Step, const T (&A)[N], std::index_sequence<I...>, const Stages &... D)
+{
+	return K0 + Step * (... + (A[I] * D));
+}
+
+template <typename T, int Dim, std::size_t N, typename... Stages>
+[[gnu::always_inline]] inline Coordinates<T, Dim> combineStages(const Coordinates<T, Dim> &K0, T Step, const T (&A)[N], const Stages &... D)
+{
+	static_assert(sizeof...(Stages) == N, "Number of the coefficients must be equal to the number of the stages");
+	return combineStages(K0, Step, A, std::make_index_sequence<N>(), D...);
+}
+
+//------------------------------------------------StartCache----------------------------------------------------------------------
+
+/**
+ * @brief class StartCache - states found by the warm-up, shared by all solvers of the process.
+ *                           The solvers are created for every run, so the cache is process-wide and guarded by the mutex.
+ *                           The key is everything the warm-up depends on: the model, its parameters and driving force,
+ *                           the solver with its settings, DeltaT and StartCoords.
+ */
+template <typename T, unsigned Dim>
+class StartCache
+{
+public:
+	struct Key
+	{
+		std::string Model;
+		ModelParameters<T> Params;
+		std::string Force;
+		std::string Solver;
+		T DeltaT;
+		Coordinates<T, Dim> StartCoords;
+
+		bool operator==(const Key &Other) const
+		{
+			return Model == Other.Model && Params.W == Other.Params.W && Params.G == Other.Params.G && Params.F == Other.Params.F && 
+			       Params.W0 == Other.Params.W0 && Force == Other.Force && Solver == Other.Solver && DeltaT == Other.DeltaT && 
+			       StartCoords == Other.StartCoords;
+		}
+	};
+
+	// The State at StartCoords[0] and the step proposed after it (DeltaT for the fixed step solvers)
+	struct Entry
+	{
+		Key StartKey;
+		Coordinates<T, Dim> State;
+		T NextStep;
+	};
+
+	static StartCache &get()
+	{
+		static StartCache Cache;
+		return Cache;
+	}
+
+	std::optional<Entry> find(const Key &StartKey) const
+	{
+		std::lock_guard<std::mutex> Lock(Mutex_);
+		for (const Entry &Cached : Entries_)
+			if (Cached.StartKey == StartKey)
+				return Cached;
+		return std::nullopt;
+	}
+
+	void add(Entry Start)
+	{
+		// The start states at zero time are free, there is nothing to save
+		if (Start.StartKey.StartCoords[0] <= 0)
+			return;
+		std::lock_guard<std::mutex> Lock(Mutex_);
+		for (const Entry &Cached : Entries_)
+			if (Cached.StartKey == Start.StartKey)
+				return;
+		if (Entries_.size() == Size_)
+			Entries_.erase(Entries_.begin());
+		Entries_.push_back(std::move(Start));
+	}
+
+	void clear()
+	{
+		std::lock_guard<std::mutex> Lock(Mutex_);
+		Entries_.clear();
+	}
+
+private:
+	static constexpr std::size_t Size_ = 64;
+	mutable std::mutex Mutex_;
+	std::vector<Entry> Entries_;
+};
+
 //----------------------------------------------------Solver----------------------------------------------------------------------
 
 /**
  * @brief class Solver - abstract class for solving a Dim-order differential equation Equation_,
- *                       with a concrete method that each child class defines
+ *                       with a concrete method that each child class defines.
+ *                       Each child class pushes the states into a TrajectorySink as they are produced (streamTrajectory),
+ *                       calculateTrajectory stores them all in the Trajectory_.
  */
 template <typename T, unsigned Dim>
 class Solver
@@ -58,29 +235,193 @@ protected:
 	const DiffEquation<T, Dim> &Equation_;
 	SequenceOfStates<T, Dim> Trajectory_;
 
+	using CheckpointFunction = std::function<void(const SolverState<T, Dim> &)>;
+
+	// Is called every CheckpointEvery_ steps and at the end of the run
+	CheckpointFunction Checkpoint_;
+	std::size_t CheckpointEvery_ = 0;
+	// If set, the next run continues from this state instead of the start
+	std::optional<SolverState<T, Dim>> Resume_;
+	// If set, the solvers, that support it, add the steps to the state by addCompensated
+	bool Compensated_ = false;
+	Coordinates<T, Dim> Compensation_;
+	// Is set by the solver before march, if its steps carry a value to the next step, and is kept in the checkpoints
+	T Carried_ = 0;
+
+	/**
+	 * @brief march - pushes K0 into the Sink and advances it with makeStep for every time step of the Range,
+	 *                until the Sink is done. The steps are counted: the times are Start + i DeltaT, not the sums of the DeltaT,
+	 *                so the round-off doesn't accumulate over the long runs and doesn't add or drop the last step.
+	 *                The time of the state is set the same way from its time at the first step.
+	 */
+	template <typename StepFunction>
+	void march(Coordinates<T, Dim> K0, TimeRange<T> Range, TrajectorySink<T, Dim> &Sink, StepFunction makeStep)
+	{
+		SolverState<T, Dim> State{K0, Range.Start, Range.DeltaT, Range.Start, K0[0], 0, Coordinates<T, Dim>(), Carried_};
+		if (Resume_)
+		{
+			State = *Resume_;
+			Resume_.reset();
+		}
+		K0 = State.State;
+		Compensation_ = State.Compensation;
+		Carried_      = State.Carried;
+		T Start = State.Start, StateStart = State.StateStart, DeltaT = State.Step;
+		std::size_t First = State.Steps, Count = getStepCount(Start, Range.Stop, DeltaT);
+		Sink.open(Count - std::min(First, Count));
+		std::size_t NextCheckpoint = getFirstCheckpoint(), i = First;
+		auto getState = [&]() { return SolverState<T, Dim>{K0, Start + T(i) * DeltaT, DeltaT, Start, StateStart, i, Compensation_, Carried_}; };
+		for (; i < Count && !Sink.done(); ++i)
+		{
+			if (i - First == NextCheckpoint)
+			{
+				Checkpoint_(getState());
+				NextCheckpoint += CheckpointEvery_;
+			}
+			Sink.push(K0);
+			K0 = makeStep(K0, DeltaT);
+			K0[0] = StateStart + T(i + 1) * DeltaT;
+		}
+		if (Checkpoint_)
+			Checkpoint_(getState());
+		if (!Sink.done())
+			Sink.pushEnd(K0);
+		Sink.close();
+	}
+
+	/**
+	 * @brief addCompensated - K0 + Increment by the compensated (Kahan-Babuska-Neumaier) summation: 
+	 *                         the rounding error of every addition is kept in the Compensation_ and added to the next increment,
+	 *                         so the error of the state doesn't grow with the number of the steps, when the increments are
+	 *                         much smaller than the state. The time isn't compensated, it is counted by march.
+	 */
+	Coordinates<T, Dim> addCompensated(const Coordinates<T, Dim> &K0, Coordinates<T, Dim> Increment)
+	{
+		Increment += Compensation_;
+		Coordinates<T, Dim> K1 = K0 + Increment;
+		for (unsigned j = 0; j < Dim; ++j)
+			Compensation_[j] = std::abs(K0[j]) >= std::abs(Increment[j]) ? (K0[j] - K1[j]) + Increment[j] : (Increment[j] - K1[j]) + K0[j];
+		Compensation_[0] = 0;
+		return K1;
+	}
+
+	/**
+	 * @brief resume - replaces the start of the run by the state to resume from, if there is one
+	 */
+	bool resume(Coordinates<T, Dim> &K0, T &Time, T &Step)
+	{
+		if (!Resume_)
+			return false;
+		K0   = Resume_->State;
+		Time = Resume_->Time;
+		Step = Resume_->Step;
+		Resume_.reset();
+		return true;
+	}
+
+	std::size_t getFirstCheckpoint() const
+	{
+		return (Checkpoint_ && CheckpointEvery_) ? CheckpointEvery_ : std::numeric_limits<std::size_t>::max();
+	}
+
+	// If set, StartCoords is the state at StartCoords[0] and there is no warm-up
+	bool StartIsState_ = false;
+
+	/**
+	 * @brief warmUp - advances StartCoords with makeStep for StartCoords[0] time units.
+	 *                 The result is kept in the StartCache, so the runs of the process from the same start don't warm up again.
+	 */
+	template <typename StepFunction>
+	Coordinates<T, Dim> warmUp(Coordinates<T, Dim> StartCoords, T DeltaT, StepFunction makeStep) const
+	{
+		if (Resume_)
+			return Resume_->State;
+		if (StartIsState_)
+			return StartCoords;
+		if (auto Cached = findStart(StartCoords, DeltaT))
+			return Cached->State;
+
+		Coordinates<T, Dim> K0 = StartCoords;
+		for (std::size_t i = 0, Count = getStepCount(T(0), StartCoords[0], DeltaT); i < Count; ++i)
+		{
+			K0 = makeStep(K0, DeltaT);
+			K0[0] = StartCoords[0] + T(i + 1) * DeltaT;
+		}
+		cacheStart(StartCoords, DeltaT, K0, DeltaT);
+		return K0;
+	}
+
+	typename StartCache<T, Dim>::Key getStartKey(const Coordinates<T, Dim> &StartCoords, T DeltaT) const
+	{
+		return typename StartCache<T, Dim>::Key{std::string(Equation_.getName()), Equation_.getParameters(), Equation_.getForceKey(), 
+		                                        getSettingsKey(), DeltaT, StartCoords};
+	}
+
+	std::optional<typename StartCache<T, Dim>::Entry> findStart(const Coordinates<T, Dim> &StartCoords, T DeltaT) const
+	{
+		return StartCache<T, Dim>::get().find(getStartKey(StartCoords, DeltaT));
+	}
+
+	void cacheStart(const Coordinates<T, Dim> &StartCoords, T DeltaT, const Coordinates<T, Dim> &State, T NextStep) const
+	{
+		StartCache<T, Dim>::get().add({getStartKey(StartCoords, DeltaT), State, NextStep});
+	}
+
+	// The name of the solver and the settings, that change its steps
+	virtual std::string getSettingsKey() const { return std::string(getName()); }
+
 public:
 
 	Solver(const DiffEquation<T, Dim> &Equation) : Equation_(Equation) {};
+	virtual ~Solver() {};
 	virtual const std::basic_string_view<char> getName() const { return "BaseSolver"; }
-	virtual void calculateTrajectory(Coordinates<T, Dim> StartCoords, TimeRange<T> Range) { return; };
+	virtual void streamTrajectory(Coordinates<T, Dim> StartCoords, TimeRange<T> Range, TrajectorySink<T, Dim> &Sink) { return; };
+	virtual void calculateTrajectory(Coordinates<T, Dim> StartCoords, TimeRange<T> Range)
+	{
+		MemorySink<T, Dim> Sink(Trajectory_);
+		streamTrajectory(StartCoords, Range, Sink);
+	}
 	virtual bool isCalculated() const { return !Trajectory_.empty(); }
-	virtual void writeSolution(std::ofstream &FileWithSolution) const
+	// Whether StartCoords is taken as the state at the time StartCoords[0] instead of being integrated for StartCoords[0]
+	void setStartIsState(bool StartIsState) { StartIsState_ = StartIsState; }
+	bool isStartState() const { return StartIsState_; }
+	static void clearStartCache() { StartCache<T, Dim>::get().clear(); }
+
+	/**
+	 * @brief setCheckpoint - Checkpoint is called with the state of the integration every Every steps (never if Every is 0)
+	 *                        and at the end of every run. An empty Checkpoint turns the checkpoints off.
+	 */
+	void setCheckpoint(std::size_t Every, CheckpointFunction Checkpoint)
 	{
-		std::for_each(Solver<T, Dim>::Trajectory_.begin(), Solver<T, Dim>::Trajectory_.end(), [&](const Coordinates<T, Dim>& K) 
-				 	{ 
-				 		FileWithSolution.write((const char *)(&K), sizeof(K)); 
-				 	});
+		CheckpointEvery_ = Every;
+		Checkpoint_      = std::move(Checkpoint);
+	}
+
+	/**
+	 * @brief resumeFrom - the next run continues from the State saved by a checkpoint instead of the StartCoords and Range.Start,
+	 *                     so the run to a new Stop continues the trajectory exactly as if it had not been interrupted
+	 */
+	void resumeFrom(const SolverState<T, Dim> &State) { Resume_ = State; }
+
+	/**
+	 * @brief setCompensated - the steps are added to the state by addCompensated,
+	 *                         only the explicit Runge-Kutta solvers calculate the steps apart from the state
+	 */
+	void setCompensated(bool Compensated)
+	{
+		if (Compensated && !supportsCompensation())
+			throw std::logic_error("Compensated summation isn't supported by the " + std::string(getName()) + " solver");
+		Compensated_ = Compensated;
 	}
 
-	virtual void writeEnergy(std::ofstream &FileWithSolution) const
+	virtual bool supportsCompensation() const { return false; }
+	// Whether the states are produced exactly Range.DeltaT apart
+	virtual bool isFixedStep() const { return true; }
+	virtual void writeSolution(std::ofstream &FileWithSolution) const
 	{
-		T W = static_cast<const HarmonicEquation<T>&>(Solver<T, Dim>::Equation_).W();
 		std::for_each(Solver<T, Dim>::Trajectory_.begin(), Solver<T, Dim>::Trajectory_.end(), [&](const Coordinates<T, Dim>& K) 
-				 	{
-				 		T Energy = 0, X = K[1], V = K[2];
-						Energy = V * V / 2 + W * W * X * X / 2;
-						FileWithSolution.write((const char *)(&K[0]), sizeof(K[0]));
-						FileWithSolution.write((const char *)(&Energy), sizeof(Energy));
+				 	{ 
+				 		FileWithSolution.write((const char *)(&K), sizeof(K)); 
 				 	});
 	}
 
@@ -96,168 +437,771 @@ public:
 
 };
 
+//------------------------------------------------StaticSolver--------------------------------------------------------------------
+
+/**
+ * @brief class StaticSolver - base class for the solvers, that know the concrete type of the equation at compile time.
+ *                             If Model is a final equation class, calls through Model_ are resolved statically
+ *                             and getDerivative is inlined into the stepping loop.
+ *                             With the default Model = DiffEquation<T, Dim> the calls stay virtual.
+ */
+template <typename T, unsigned Dim, typename Model = DiffEquation<T, Dim>>
+class StaticSolver : public Solver<T, Dim>
+{
+protected:
+	const Model &Model_;
+
+public:
+	StaticSolver(const Model &Equation) : Solver<T, Dim>(Equation), Model_(Equation) {};
+};
+
 //------------------------------------------------AnalyticalSolver----------------------------------------------------------------
 
 /**
  * @brief class AnalyticalSolver - solves the Equation_ analytically
  */
-template <typename T, unsigned Dim>
-class AnalyticalSolver : public Solver<T, Dim>
+template <typename T, unsigned Dim, typename Model = DiffEquation<T, Dim>>
+class AnalyticalSolver : public StaticSolver<T, Dim, Model>
 {
 	SequenceOfConstants<T, Dim> Constants_;
 
 public:
-	AnalyticalSolver(DiffEquation<T, Dim> &Equation) : Solver<T, Dim>(Equation) {};
+	AnalyticalSolver(const Model &Equation) : StaticSolver<T, Dim, Model>(Equation) {};
 	const std::basic_string_view<char> getName() const override { return magic_enum::enum_name(Solvers::Analitic); }
 
 	void setConstants(Coordinates<T, Dim> StartCoords)
 	{
-		Constants_ = Solver<T, Dim>::Equation_.getConstants(StartCoords);
+		Constants_ = StaticSolver<T, Dim, Model>::Model_.getConstants(StartCoords);
 	}
 
-	void calculateTrajectory(Coordinates<T, Dim> StartCoords, TimeRange<T> Range) override
+	/**
+	 * @brief streamTrajectory - the states at Start + i DeltaT are calculated by blocks of BlockSize with Model_.getStates
+	 */
+	void streamTrajectory(Coordinates<T, Dim> StartCoords, TimeRange<T> Range, TrajectorySink<T, Dim> &Sink) override
 	{
-		T Start = Range.Start, Stop = Range.Stop, DeltaT = Range.DeltaT;
-		Solver<T, Dim>::Trajectory_.clear();
-		Solver<T, Dim>::Trajectory_.reserve((Stop - Start) / DeltaT + 1);
-		for (T Time = Start; Time < Stop; Time += DeltaT)
-			Solver<T, Dim>::Trajectory_.emplace_back(Solver<T, Dim>::Equation_.getState(Time, Constants_));
+		setConstants(StartCoords);
+		T Start = Range.Start, DeltaT = Range.DeltaT;
+		std::size_t First = 0;
+		if (Solver<T, Dim>::Resume_)
+		{
+			Start  = Solver<T, Dim>::Resume_->Start;
+			DeltaT = Solver<T, Dim>::Resume_->Step;
+			First  = Solver<T, Dim>::Resume_->Steps;
+			Solver<T, Dim>::Resume_.reset();
+		}
+		// The same number of states as march makes, their times are Start + i DeltaT
+		std::size_t Count = getStepCount(Start, Range.Stop, DeltaT);
+		Sink.open(Count - std::min(First, Count));
+
+		// The blocks start at the multiples of BlockSize, so the resumed run calculates the same states as the uninterrupted one
+		std::vector<Coordinates<T, Dim>> Block(std::min(Count, BlockSize));
+		std::size_t NextCheckpoint = Solver<T, Dim>::getFirstCheckpoint(), Index = First;
+		for (std::size_t Base = First - First % BlockSize; Index < Count && !Sink.done(); Base += BlockSize)
+		{
+			std::size_t Size = std::min(BlockSize, Count - Base);
+			StaticSolver<T, Dim, Model>::Model_.getStates(Start + Base * DeltaT, DeltaT, Constants_, Block.data(), Size);
+			for (; Index < Base + Size && !Sink.done(); ++Index)
+			{
+				const Coordinates<T, Dim> &State = Block[Index - Base];
+				if (Index - First == NextCheckpoint)
+				{
+					Solver<T, Dim>::Checkpoint_(SolverState<T, Dim>{State, State[0], DeltaT, Start, Start, Index});
+					NextCheckpoint += Solver<T, Dim>::CheckpointEvery_;
+				}
+				Sink.push(State);
+			}
+		}
+		if (Solver<T, Dim>::Checkpoint_)
+		{
+			T Time = Start + Index * DeltaT;
+			Solver<T, Dim>::Checkpoint_(SolverState<T, Dim>{StaticSolver<T, Dim, Model>::Model_.getState(Time, Constants_), Time, DeltaT, 
+			                                                Start, Start, Index});
+		}
+		if (!Sink.done())
+			Sink.pushEnd(StaticSolver<T, Dim, Model>::Model_.getState(Start + T(Count) * DeltaT, Constants_));
+		Sink.close();
 	}
+
+private:
+	// The block is a multiple of the TransitionTable, so the table is made once per BlockSize states
+	static constexpr std::size_t BlockSize = 64 * TransitionTable<T>::Size;
 };
 	
-//---------------------------------------------------EilerSolver----------------------------------------------------------------
+//---------------------------------------------ExplicitRungeKuttaSolver-----------------------------------------------------------
 
 /**
- * @brief class EilerSolver - solves the Equation_ using Euler's numerical iterative method
+ * @brief class ExplicitRungeKuttaSolver - solves the Equation_ using the explicit Runge-Kutta method of the Tableau
+ *                                         (see ButcherTableau.hpp) with the fixed step.
+ *                                         The stages are unrolled at compile time, every stage state sums only
+ *                                         the nonzero coefficients of its row, so the methods with the integer coefficients
+ *                                         are calculated as if they were written by hand.
  */
-template <typename T, unsigned Dim>
-class EilerSolver : public Solver<T, Dim>
+template <typename T, unsigned Dim, typename Tableau, Solvers Method, typename Model = DiffEquation<T, Dim>>
+class ExplicitRungeKuttaSolver : public StaticSolver<T, Dim, Model>
 {
+	static_assert(isConsistent<Tableau>(), "The weights B must sum to 1 and the rows of A to C");
+
+	static constexpr std::size_t Stages_ = Tableau::Stages;
+	using StageDerivatives = std::array<Coordinates<T, Dim>, Stages_>;
+
 	T DeltaT_;
 
 public:
-	EilerSolver(DiffEquation<T, Dim> &Equation, T DeltaT = 0.01) : Solver<T, Dim>(Equation), DeltaT_(DeltaT) {};
-	const std::basic_string_view<char> getName() const override { return magic_enum::enum_name(Solvers::Eiler); }
+	ExplicitRungeKuttaSolver(const Model &Equation, T DeltaT = 0.01) : StaticSolver<T, Dim, Model>(Equation), DeltaT_(DeltaT) {};
+	const std::basic_string_view<char> getName() const override { return magic_enum::enum_name(Method); }
 
-	void calculateTrajectory(Coordinates<T, Dim> StartCoords, TimeRange<T> Range) override
+	void streamTrajectory(Coordinates<T, Dim> StartCoords, TimeRange<T> Range, TrajectorySink<T, Dim> &Sink) override
 	{
-		T Start = Range.Start, Stop = Range.Stop, DeltaT = Range.DeltaT;
-		Solver<T, Dim>::Trajectory_.clear();
-		Solver<T, Dim>::Trajectory_.reserve((Stop - Start) / DeltaT + 1);
-		Coordinates<T, Dim> K1, K0 = getStart(StartCoords, DeltaT);
-		for (T Time = Start; Time < Stop; Time += DeltaT)
-		{
-			K1    = K0   + DeltaT * Solver<T, Dim>::Equation_.getDerivative(K0);
-			Solver<T, Dim>::Trajectory_.push_back(K0);
-			K0    = K1;
-		}
+		if (Solver<T, Dim>::Compensated_)
+			Solver<T, Dim>::march(getStart(StartCoords, Range.DeltaT), Range, Sink, [this](const Coordinates<T, Dim> &K0, T DeltaT)
+			                      { return Solver<T, Dim>::addCompensated(K0, makeIncrement(K0, DeltaT)); });
+		else
+			Solver<T, Dim>::march(getStart(StartCoords, Range.DeltaT), Range, Sink, 
+			                      [this](const Coordinates<T, Dim> &K0, T DeltaT) { return makeStep(K0, DeltaT); });
 	}
 
 	Coordinates<T, Dim> getStart(Coordinates<T, Dim> StartCoords, T DeltaT) const
 	{
-		Coordinates<T, Dim> K1, K0 = StartCoords;
-		for (T Time = 0; Time < StartCoords[0]; Time += DeltaT)
+		return Solver<T, Dim>::warmUp(StartCoords, DeltaT, 
+		                              [this](const Coordinates<T, Dim> &K0, T DeltaT) { return makeStep(K0, DeltaT); });
+	}
+
+	bool supportsCompensation() const override { return true; }
+
+	Coordinates<T, Dim> makeStep(const Coordinates<T, Dim> &K0, T DeltaT) const
+	{
+		StageDerivatives D;
+		computeStages(K0, DeltaT, D, std::make_index_sequence<Stages_>());
+		return getRowState<Stages_>(K0, DeltaT, D, std::make_index_sequence<countTerms(Stages_)>());
+	}
+
+	/**
+	 * @brief makeIncrement - the step without the state, makeStep(K0, DeltaT) = K0 + makeIncrement(K0, DeltaT)
+	 */
+	Coordinates<T, Dim> makeIncrement(const Coordinates<T, Dim> &K0, T DeltaT) const
+	{
+		StageDerivatives D;
+		computeStages(K0, DeltaT, D, std::make_index_sequence<Stages_>());
+		return getRowState<Stages_>(Coordinates<T, Dim>(), DeltaT, D, std::make_index_sequence<countTerms(Stages_)>());
+	}
+
+private:
+	// The row Stages_ is the row of the weights B
+	static constexpr double getCoefficient(std::size_t Row, std::size_t Column) { return Row < Stages_ ? Tableau::A[Row][Column] : Tableau::B[Column]; }
+	static constexpr double getDivisor(std::size_t Row) { return Row < Stages_ ? Tableau::Divisor[Row] : Tableau::BDivisor; }
+
+	static constexpr std::size_t countTerms(std::size_t Row)
+	{
+		std::size_t Count = 0;
+		for (std::size_t Column = 0; Column < std::min(Row, Stages_); ++Column)
+			Count += getCoefficient(Row, Column) != 0;
+		return Count;
+	}
+
+	// Columns of the nonzero coefficients of the Row
+	template <std::size_t Row>
+	static constexpr std::array<std::size_t, countTerms(Row)> getTerms()
+	{
+		std::array<std::size_t, countTerms(Row)> Terms{};
+		for (std::size_t Column = 0, i = 0; Column < std::min(Row, Stages_); ++Column)
+			if (getCoefficient(Row, Column) != 0)
+				Terms[i++] = Column;
+		return Terms;
+	}
+
+	template <std::size_t Row, std::size_t... I>
+	[[gnu::always_inline]] Coordinates<T, Dim> getRowState(const Coordinates<T, Dim> &K0, T DeltaT, const StageDerivatives &D, 
+	                                                       std::index_sequence<I...>) const
+	{
+		if constexpr (sizeof...(I) == 0)
+			return K0;
+		else
 		{
-			K1 = K0 + DeltaT * Solver<T, Dim>::Equation_.getDerivative(K0);
-			K0 = K1;
+			constexpr std::array<std::size_t, sizeof...(I)> Terms = getTerms<Row>();
+			return combineStages(K0, DeltaT / T(getDivisor(Row)), {T(getCoefficient(Row, Terms[I]))...}, D[Terms[I]]...);
 		}
-		return K0;
+	}
+
+	template <std::size_t... Row>
+	[[gnu::always_inline]] void computeStages(const Coordinates<T, Dim> &K0, T DeltaT, StageDerivatives &D, std::index_sequence<Row...>) const
+	{
+		const Model &Equation = StaticSolver<T, Dim, Model>::Model_;
+		((D[Row] = Equation.getDerivative(getRowState<Row>(K0, DeltaT, D, std::make_index_sequence<countTerms(Row)>()))), ...);
 	}
 };
 
+//---------------------------------------------------EilerSolver----------------------------------------------------------------
+
+/**
+ * @brief EilerSolver - solves the Equation_ using Euler's numerical iterative method
+ */
+template <typename T, unsigned Dim, typename Model = DiffEquation<T, Dim>>
+using EilerSolver = ExplicitRungeKuttaSolver<T, Dim, EulerTableau, Solvers::Eiler, Model>;
+
 //---------------------------------------------------HeunSolver-------------------------------------------------------------------
 
 /**
- * @brief class HeunSolver - solves the Equation_ using specified Euler's method
- *                            called Heun's scheme. Iterative numerical solution in two stages (predictive-corrector)
- *                            based on the trapezoid method.
+ * @brief HeunSolver - solves the Equation_ using specified Euler's method
+ *                     called Heun's scheme. Iterative numerical solution in two stages (predictive-corrector)
+ *                     based on the trapezoid method.
  */
-template <typename T, unsigned Dim>
-class HeunSolver : public Solver<T, Dim>
+template <typename T, unsigned Dim, typename Model = DiffEquation<T, Dim>>
+using HeunSolver = ExplicitRungeKuttaSolver<T, Dim, HeunTableau, Solvers::Heun, Model>;
+
+//---------------------------------------------------RungeKuttaSolver-------------------------------------------------------------------
+
+/**
+ * @brief RungeKuttaSolver - solves the Equation_ using Runge-Kutta method,
+ *                           that helps to numerically integrate the equations 
+ *                           by calculating a new value in four steps.
+ */
+template <typename T, unsigned Dim, typename Model = DiffEquation<T, Dim>>
+using RungeKuttaSolver = ExplicitRungeKuttaSolver<T, Dim, RungeKutta4Tableau, Solvers::RungeKutta, Model>;
+
+//---------------------------------------------------DormandPrinceSolver-------------------------------------------------------------------
+
+/**
+ * @brief class DormandPrinceSolver - solves the Equation_ using the embedded Runge-Kutta 5(4) pair of Dormand and Prince.
+ *                                    The difference between the 5th and 4th order solutions estimates the local error,
+ *                                    and the step is adjusted so that this error meets the Tolerance_.
+ *                                    The last stage of an accepted step is the first stage of the next one (FSAL),
+ *                                    so an accepted step costs six derivative evaluations.
+ */
+template <typename T, unsigned Dim, typename Model = DiffEquation<T, Dim>>
+class DormandPrinceSolver : public StaticSolver<T, Dim, Model>
 {
 	T DeltaT_;
+	Tolerance<T> Tolerance_;
+
+	static constexpr T SafetyFactor_ = 0.9;
+	static constexpr T MinScale_     = 0.2;
+	static constexpr T MaxScale_     = 5.0;
 
 public:
-	HeunSolver(DiffEquation<T, Dim> &Equation, T DeltaT = 0.01) : Solver<T, Dim>(Equation), DeltaT_(DeltaT) {};
-	const std::basic_string_view<char> getName() const override { return magic_enum::enum_name(Solvers::Heun); }
+	DormandPrinceSolver(const Model &Equation, T DeltaT = 0.01, Tolerance<T> Tol = Tolerance<T>()) : 
+	StaticSolver<T, Dim, Model>(Equation), DeltaT_(DeltaT), Tolerance_(Tol) {};
+	const std::basic_string_view<char> getName() const override { return magic_enum::enum_name(Solvers::DormandPrince); }
+	bool isFixedStep() const override { return false; }
 
-	void calculateTrajectory(Coordinates<T, Dim> StartCoords, TimeRange<T> Range) override
+	// The warm-up depends on the tolerances
+	std::string getSettingsKey() const override
 	{
-		T Start = Range.Start, Stop = Range.Stop, DeltaT = Range.DeltaT;
-		Solver<T, Dim>::Trajectory_.clear();
-		Solver<T, Dim>::Trajectory_.reserve((Stop - Start) / DeltaT + 1);
-		Coordinates<T, Dim> K1, K2, K0 = getStart(StartCoords, DeltaT);
-		for (T Time = Start; Time < Stop; Time += DeltaT)
+		std::ostringstream Key;
+		Key << std::hexfloat << getName() << ' ' << Tolerance_.Abs << ' ' << Tolerance_.Rel;
+		return Key.str();
+	}
+
+	void streamTrajectory(Coordinates<T, Dim> StartCoords, TimeRange<T> Range, TrajectorySink<T, Dim> &Sink) override
+	{
+		T Time = Range.Start, Stop = Range.Stop, H = Range.DeltaT;
+		Coordinates<T, Dim> K0 = getStart(StartCoords, H);
+		Solver<T, Dim>::resume(K0, Time, H);
+		Coordinates<T, Dim> D1 = StaticSolver<T, Dim, Model>::Model_.getDerivative(K0);
+		Sink.open(0);
+		std::size_t Steps = 0, NextCheckpoint = Solver<T, Dim>::getFirstCheckpoint();
+		while (Time < Stop && !Sink.done())
 		{
-			K1    = K0 + DeltaT * Solver<T, Dim>::Equation_.getDerivative(K0);
-			K2    = K0 + DeltaT / 2 * (Solver<T, Dim>::Equation_.getDerivative(K0) + Solver<T, Dim>::Equation_.getDerivative(K1));
-			Solver<T, Dim>::Trajectory_.push_back(K0);
-			K0   = K2;
+			if (Steps++ == NextCheckpoint)
+			{
+				Solver<T, Dim>::Checkpoint_(SolverState<T, Dim>{K0, Time, H});
+				NextCheckpoint += Solver<T, Dim>::CheckpointEvery_;
+			}
+			Sink.push(K0);
+			Time += makeStep(K0, D1, H, Stop - Time);
 		}
+		if (Solver<T, Dim>::Checkpoint_)
+			Solver<T, Dim>::Checkpoint_(SolverState<T, Dim>{K0, Time, H});
+		if (!Sink.done())
+			Sink.pushEnd(K0);
+		Sink.close();
 	}
 
-	Coordinates<T, Dim> getStart(Coordinates<T, Dim> StartCoords, T DeltaT) const
+	Coordinates<T, Dim> getStart(Coordinates<T, Dim> StartCoords, T &H) const
 	{
-		Coordinates<T, Dim> K1, K2, K0 = StartCoords;
-		for (T Time = 0; Time < StartCoords[0]; Time += DeltaT)
+		if (Solver<T, Dim>::Resume_)
+			return Solver<T, Dim>::Resume_->State;
+		if (Solver<T, Dim>::StartIsState_)
+			return StartCoords;
+		if (auto Cached = Solver<T, Dim>::findStart(StartCoords, H))
 		{
-			K1 = K0 + DeltaT * Solver<T, Dim>::Equation_.getDerivative(K0);
-			K2 = K0 + DeltaT / 2 * (Solver<T, Dim>::Equation_.getDerivative(K0) + Solver<T, Dim>::Equation_.getDerivative(K1));
-			K0 = K2;
+			H = Cached->NextStep;
+			return Cached->State;
 		}
+
+		T InitialH = H;
+		Coordinates<T, Dim> K0 = StartCoords;
+		Coordinates<T, Dim> D1 = StaticSolver<T, Dim, Model>::Model_.getDerivative(K0);
+		T Time = 0;
+		while (Time < StartCoords[0])
+			Time += makeStep(K0, D1, H, StartCoords[0] - Time);
+		Solver<T, Dim>::cacheStart(StartCoords, InitialH, K0, H);
 		return K0;
 	}
+
+	/**
+	 * @brief makeStep - advances K0 by one accepted step not longer than MaxH.
+	 *                   D1 holds the derivative in K0 and is updated together with it,
+	 *                   H is the proposed step size and is replaced by the proposal for the next step.
+	 *
+	 * @return the size of the accepted step
+	 */
+	T makeStep(Coordinates<T, Dim> &K0, Coordinates<T, Dim> &D1, T &H, T MaxH) const
+	{
+		const Model &Equation = StaticSolver<T, Dim, Model>::Model_;
+		Coordinates<T, Dim> D2, D3, D4, D5, D6, D7, K1;
+		while (true)
+		{
+			T Step = std::min(H, MaxH);
+			if (Step <= std::numeric_limits<T>::epsilon() * std::max(std::abs(K0[0]), T(1)))
+				throw std::logic_error("DormandPrince step size underflow: tolerance can't be reached");
+
+			D2 = Equation.getDerivative(combineStages(K0, Step, {T(1) / 5}, D1));
+			D3 = Equation.getDerivative(combineStages(K0, Step, {T(3) / 40, T(9) / 40}, D1, D2));
+			D4 = Equation.getDerivative(combineStages(K0, Step, {T(44) / 45, -T(56) / 15, T(32) / 9}, D1, D2, D3));
+			D5 = Equation.getDerivative(combineStages(K0, Step, {T(19372) / 6561, -T(25360) / 2187, T(64448) / 6561, -T(212) / 729}, 
+			                                          D1, D2, D3, D4));
+			D6 = Equation.getDerivative(combineStages(K0, Step, {T(9017) / 3168, -T(355) / 33, T(46732) / 5247, T(49) / 176, -T(5103) / 18656}, 
+			                                          D1, D2, D3, D4, D5));
+			K1 = combineStages(K0, Step, {T(35) / 384, T(500) / 1113, T(125) / 192, -T(2187) / 6784, T(11) / 84}, D1, D3, D4, D5, D6);
+			D7 = Equation.getDerivative(K1);
+
+			// Difference between the 5th and the embedded 4th order solutions
+			Coordinates<T, Dim> Error = combineStages(Coordinates<T, Dim>(), Step, 
+			                                          {T(71) / 57600, -T(71) / 16695, T(71) / 1920, -T(17253) / 339200, T(22) / 525, -T(1) / 40}, 
+			                                          D1, D3, D4, D5, D6, D7);
+			T Norm = getErrorNorm(K0, K1, Error);
+			T Scale = Norm == 0 ? MaxScale_ : std::clamp(SafetyFactor_ * std::pow(Norm, T(-0.2)), MinScale_, MaxScale_);
+
+			if (Norm <= 1)
+			{
+				// A step shortened by MaxH must not shrink the proposal for the next one
+				H  = (Step < H) ? std::max(H, Step * Scale) : Step * Scale;
+				K0 = K1;
+				D1 = D7;
+				return Step;
+			}
+			H = Step * std::min(Scale, T(1));
+		}
+	}
+
+	/**
+	 * @brief getErrorNorm - root mean square of the Error components, 
+	 *                       each weighted by Tolerance_.Abs + Tolerance_.Rel * max(|K0|, |K1|)
+	 */
+	T getErrorNorm(const Coordinates<T, Dim> &K0, const Coordinates<T, Dim> &K1, const Coordinates<T, Dim> &Error) const
+	{
+		T Sum = 0;
+		for (unsigned i = 0; i < Dim; ++i)
+		{
+			T Scale = Tolerance_.Abs + Tolerance_.Rel * std::max(std::abs(K0[i]), std::abs(K1[i]));
+			Sum += (Error[i] / Scale) * (Error[i] / Scale);
+		}
+		return std::sqrt(Sum / Dim);
+	}
 };
 
-//---------------------------------------------------RungeKuttaSolver-------------------------------------------------------------------
+//---------------------------------------------------SplitStepSolver-------------------------------------------------------------------
 
 /**
- * @brief class RungeKuttaSolver - solves the Equation_ using Runge-Kutta method,
- *                                 that helps to numerically integrate the equations 
- *                                 by calculating a new value in four steps.
+ * @brief class SplitStepSolver - solves the Equation_ x' = v, v' = a(t, x) by the composition of Stages velocity Verlet steps
+ *                                with the lengths Weights_[i] * DeltaT. Each Verlet step is a half kick of the velocity,
+ *                                a drift of the coordinate (and of the time) and another half kick:
+ *
+ *                                    v += H/2 a(t, x),   x += H v,   t += H,   v += H/2 a(t, x).
+ *
+ *              The steps are symplectic, so for the conservative equations (Math, Phys) the energy error
+ *              stays bounded instead of drifting. The acceleration of the last kick is the acceleration of the next kick,
+ *              so a step costs Stages derivative evaluations.
+ *              If the acceleration depends on the velocity (friction), the kick uses the velocity at its beginning
+ *              and the method is only of the first order.
  */
-template <typename T, unsigned Dim>
-class RungeKuttaSolver : public Solver<T, Dim>
+template <typename T, unsigned Dim, std::size_t Stages, typename Model = DiffEquation<T, Dim>>
+class SplitStepSolver : public StaticSolver<T, Dim, Model>
 {
+	static_assert(Dim == 3, "SplitStepSolver needs the state {Time, X, V}");
+
 	T DeltaT_;
+	std::array<T, Stages> Weights_;
 
 public:
-	RungeKuttaSolver(DiffEquation<T, Dim> &Equation, T DeltaT = 0.01) : Solver<T, Dim>(Equation), DeltaT_(DeltaT) {};
-	const std::basic_string_view<char> getName() const override { return magic_enum::enum_name(Solvers::RungeKutta); }
+	SplitStepSolver(const Model &Equation, T DeltaT, const std::array<T, Stages> &Weights) : 
+	StaticSolver<T, Dim, Model>(Equation), DeltaT_(DeltaT), Weights_(Weights) {};
+
+	void streamTrajectory(Coordinates<T, Dim> StartCoords, TimeRange<T> Range, TrajectorySink<T, Dim> &Sink) override
+	{
+		Coordinates<T, Dim> K0 = getStart(StartCoords, Range.DeltaT);
+		// The acceleration is carried in the Carried_, so the checkpoint keeps it and the resumed run is the same as the continuous one
+		Solver<T, Dim>::Carried_ = getAcceleration(K0);
+		Solver<T, Dim>::march(K0, Range, Sink, 
+		                      [this](const Coordinates<T, Dim> &K0, T DeltaT) { return makeStep(K0, Solver<T, Dim>::Carried_, DeltaT); });
+	}
+
+	Coordinates<T, Dim> getStart(Coordinates<T, Dim> StartCoords, T DeltaT) const
+	{
+		T A = getAcceleration(StartCoords);
+		return Solver<T, Dim>::warmUp(StartCoords, DeltaT, 
+		                              [this, &A](const Coordinates<T, Dim> &K0, T DeltaT) { return makeStep(K0, A, DeltaT); });
+	}
 
-	void calculateTrajectory(Coordinates<T, Dim> StartCoords, TimeRange<T> Range) override
+	/**
+	 * @brief makeStep - A holds the acceleration in K0 and is replaced by the acceleration in the returned state
+	 */
+	Coordinates<T, Dim> makeStep(Coordinates<T, Dim> K0, T &A, T DeltaT) const
 	{
-		T Start = Range.Start, Stop = Range.Stop, DeltaT = Range.DeltaT;
-		Solver<T, Dim>::Trajectory_.clear();
-		Solver<T, Dim>::Trajectory_.reserve((Stop - Start) / DeltaT + 1);
-		Coordinates<T, Dim> K1, K2, D1, D2, D3, D4, K0 = getStart(StartCoords, DeltaT);
-		for (T Time = Start; Time < Stop; Time += DeltaT)
+		for (T Weight : Weights_)
 		{
-			D1 = Solver<T, Dim>::Equation_.getDerivative(K0);
-			D2 = Solver<T, Dim>::Equation_.getDerivative(K0 + DeltaT / 2 * D1);
-			D3 = Solver<T, Dim>::Equation_.getDerivative(K0 + DeltaT / 2 * D2);
-			D4 = Solver<T, Dim>::Equation_.getDerivative(K0 + DeltaT * D3);
-			K1 = K0 + DeltaT / 6 * (D1 + 2 * D2 + 2 * D3 + D4);
-			Solver<T, Dim>::Trajectory_.push_back(K0);
-			K0 = K1;
+			T H = Weight * DeltaT;
+			K0[2] += H / 2 * A;
+			K0[0] += H;
+			K0[1] += H * K0[2];
+			A = getAcceleration(K0);
+			K0[2] += H / 2 * A;
 		}
+		return K0;
+	}
+
+private:
+	T getAcceleration(const Coordinates<T, Dim> &K) const { return StaticSolver<T, Dim, Model>::Model_.getDerivative(K)[2]; }
+};
+
+//---------------------------------------------------StormerVerletSolver-------------------------------------------------------------------
+
+/**
+ * @brief class StormerVerletSolver - the velocity form of the second order Stormer-Verlet method
+ */
+template <typename T, unsigned Dim, typename Model = DiffEquation<T, Dim>>
+class StormerVerletSolver : public SplitStepSolver<T, Dim, 1, Model>
+{
+public:
+	StormerVerletSolver(const Model &Equation, T DeltaT = 0.01) : SplitStepSolver<T, Dim, 1, Model>(Equation, DeltaT, {T(1)}) {};
+	const std::basic_string_view<char> getName() const override { return magic_enum::enum_name(Solvers::StormerVerlet); }
+};
+
+//---------------------------------------------------Yoshida4Solver-------------------------------------------------------------------
+
+/**
+ * @brief class Yoshida4Solver - fourth order symplectic method of Yoshida: three Verlet steps with the weights
+ *                               W1, W0, W1, where W1 = 1 / (2 - 2^(1/3)), W0 = 1 - 2 W1
+ */
+template <typename T, unsigned Dim, typename Model = DiffEquation<T, Dim>>
+class Yoshida4Solver : public SplitStepSolver<T, Dim, 3, Model>
+{
+	static constexpr T W1_ =  1.35120719195965763404768780897;
+	static constexpr T W0_ = -1.70241438391931526809537561794;
+
+public:
+	Yoshida4Solver(const Model &Equation, T DeltaT = 0.01) : SplitStepSolver<T, Dim, 3, Model>(Equation, DeltaT, {W1_, W0_, W1_}) {};
+	const std::basic_string_view<char> getName() const override { return magic_enum::enum_name(Solvers::Yoshida4); }
+};
+
+//---------------------------------------------------Yoshida6Solver-------------------------------------------------------------------
+
+/**
+ * @brief class Yoshida6Solver - sixth order symplectic method of Yoshida (solution A): seven Verlet steps with the weights
+ *                               W3, W2, W1, W0, W1, W2, W3, where W0 = 1 - 2 (W1 + W2 + W3)
+ */
+template <typename T, unsigned Dim, typename Model = DiffEquation<T, Dim>>
+class Yoshida6Solver : public SplitStepSolver<T, Dim, 7, Model>
+{
+	static constexpr T W1_ = -1.17767998417887100694641568096;
+	static constexpr T W2_ =  0.235573213359358133684793182978;
+	static constexpr T W3_ =  0.784513610477557263819497633866;
+	static constexpr T W0_ =  1 - 2 * (W1_ + W2_ + W3_);
+
+public:
+	Yoshida6Solver(const Model &Equation, T DeltaT = 0.01) : 
+	SplitStepSolver<T, Dim, 7, Model>(Equation, DeltaT, {W3_, W2_, W1_, W0_, W1_, W2_, W3_}) {};
+	const std::basic_string_view<char> getName() const override { return magic_enum::enum_name(Solvers::Yoshida6); }
+};
+
+//---------------------------------------------------RadauIIASolver-------------------------------------------------------------------
+
+/**
+ * @brief class RadauIIASolver - solves the Equation_ using the implicit three-stage Radau IIA method of the fifth order.
+ *                               The method is L-stable, so the step is limited by the accuracy and not by the stability
+ *                               of the stiff equations, like the heavily overdamped oscillator (G >> W).
+ *
+ *              The increments of the stages Z_i = Y_i - K0 solve the nonlinear system
+ *
+ *                                  Z_i = DeltaT * Sum_j A_ij getDerivative(K0 + Z_j),
+ *
+ *              which is solved by the simplified Newton iteration with the Jacobian of the equation in K0 (getJacobian).
+ *              The last stage is the new state. If the iteration doesn't converge, the step is made in two halves.
+ */
+template <typename T, unsigned Dim, typename Model = DiffEquation<T, Dim>>
+class RadauIIASolver : public StaticSolver<T, Dim, Model>
+{
+	static constexpr unsigned Stages_ = 3;
+	static constexpr unsigned Size_   = Stages_ * Dim;
+	static constexpr unsigned MaxIterations_ = 10;
+	static constexpr unsigned MaxHalvings_   = 20;
+
+	static constexpr T Sqrt6_ = 2.44948974278317809819728407471;
+	static constexpr T A_[Stages_][Stages_] = {{(88 - 7 * Sqrt6_) / 360,     (296 - 169 * Sqrt6_) / 1800, (-2 + 3 * Sqrt6_) / 225},
+	                                           {(296 + 169 * Sqrt6_) / 1800, (88 + 7 * Sqrt6_) / 360,     (-2 - 3 * Sqrt6_) / 225},
+	                                           {(16 - Sqrt6_) / 36,          (16 + Sqrt6_) / 36,          T(1) / 9}};
+
+	using StageVector = std::array<T, Size_>;
+	using StageMatrix = std::array<T, Size_ * Size_>;
+
+	T DeltaT_;
+	T NewtonTolerance_ = std::pow(std::numeric_limits<T>::epsilon(), T(2) / 3);
+
+public:
+	RadauIIASolver(const Model &Equation, T DeltaT = 0.01) : StaticSolver<T, Dim, Model>(Equation), DeltaT_(DeltaT) {};
+	const std::basic_string_view<char> getName() const override { return magic_enum::enum_name(Solvers::RadauIIA); }
+
+	void streamTrajectory(Coordinates<T, Dim> StartCoords, TimeRange<T> Range, TrajectorySink<T, Dim> &Sink) override
+	{
+		Solver<T, Dim>::march(getStart(StartCoords, Range.DeltaT), Range, Sink, 
+		                      [this](const Coordinates<T, Dim> &K0, T DeltaT) { return makeStep(K0, DeltaT); });
 	}
 
 	Coordinates<T, Dim> getStart(Coordinates<T, Dim> StartCoords, T DeltaT) const
 	{
-		Coordinates<T, Dim> K1, K2, D1, D2, D3, D4, K0 = StartCoords;
-		for (T Time = 0; Time < StartCoords[0]; Time += DeltaT)
+		return Solver<T, Dim>::warmUp(StartCoords, DeltaT, 
+		                              [this](const Coordinates<T, Dim> &K0, T DeltaT) { return makeStep(K0, DeltaT); });
+	}
+
+	Coordinates<T, Dim> makeStep(const Coordinates<T, Dim> &K0, T DeltaT, unsigned Halvings = 0) const
+	{
+		Coordinates<T, Dim> K1;
+		if (solveStages(K0, DeltaT, K1))
+			return K1;
+		if (Halvings == MaxHalvings_)
+			throw std::logic_error("Newton iteration of the RadauIIA method doesn't converge");
+		return makeStep(makeStep(K0, DeltaT / 2, Halvings + 1), DeltaT / 2, Halvings + 1);
+	}
+
+private:
+	bool solveStages(const Coordinates<T, Dim> &K0, T DeltaT, Coordinates<T, Dim> &K1) const
+	{
+		const Model &Equation = StaticSolver<T, Dim, Model>::Model_;
+		JacobianMatrix<T, Dim> Jacobian = Equation.getJacobian(K0);
+
+		// Newton matrix I - DeltaT * (A x Jacobian), it is factorized once per step
+		StageMatrix Matrix;
+		std::array<unsigned, Size_> Pivots;
+		for (unsigned i = 0; i < Stages_; ++i)
+			for (unsigned j = 0; j < Stages_; ++j)
+				for (unsigned Row = 0; Row < Dim; ++Row)
+					for (unsigned Column = 0; Column < Dim; ++Column)
+						Matrix[(i * Dim + Row) * Size_ + j * Dim + Column] = 
+						    T(i == j && Row == Column) - DeltaT * A_[i][j] * Jacobian[Column][Row];
+		if (!factorize(Matrix, Pivots))
+			return false;
+
+		Coordinates<T, Dim> Z[Stages_] = {}, D[Stages_];
+		T LastNorm = std::numeric_limits<T>::max();
+		for (unsigned Iteration = 0; Iteration < MaxIterations_; ++Iteration)
 		{
-			D1 = Solver<T, Dim>::Equation_.getDerivative(K0);
-			D2 = Solver<T, Dim>::Equation_.getDerivative(K0 + DeltaT / 2 * D1);
-			D3 = Solver<T, Dim>::Equation_.getDerivative(K0 + DeltaT / 2 * D2);
-			D4 = Solver<T, Dim>::Equation_.getDerivative(K0 + DeltaT * D3);
-			K1 = K0 + DeltaT / 6 * (D1 + 2 * D2 + 2 * D3 + D4);
-			K0 = K1;
+			for (unsigned i = 0; i < Stages_; ++i)
+				D[i] = Equation.getDerivative(K0 + Z[i]);
+
+			StageVector Correction;
+			for (unsigned i = 0; i < Stages_; ++i)
+			{
+				Coordinates<T, Dim> Residual = DeltaT * (A_[i][0] * D[0] + A_[i][1] * D[1] + A_[i][2] * D[2]) - Z[i];
+				for (unsigned Row = 0; Row < Dim; ++Row)
+					Correction[i * Dim + Row] = Residual[Row];
+			}
+			solve(Matrix, Pivots, Correction);
+
+			T Norm = 0;
+			for (unsigned i = 0; i < Stages_; ++i)
+				for (unsigned Row = 0; Row < Dim; ++Row)
+				{
+					Z[i][Row] += Correction[i * Dim + Row];
+					Norm = std::max(Norm, std::abs(Correction[i * Dim + Row]) / (1 + std::abs(K0[Row])));
+				}
+			if (Norm <= NewtonTolerance_)
+			{
+				K1 = K0 + Z[Stages_ - 1];
+				return true;
+			}
+			if (!(Norm < LastNorm))
+				return false;
+			LastNorm = Norm;
+		}
+		return false;
+	}
+
+	// LU decomposition with partial pivoting in place, false if the Matrix is singular
+	static bool factorize(StageMatrix &Matrix, std::array<unsigned, Size_> &Pivots)
+	{
+		for (unsigned k = 0; k < Size_; ++k)
+		{
+			unsigned Pivot = k;
+			for (unsigned i = k + 1; i < Size_; ++i)
+				if (std::abs(Matrix[i * Size_ + k]) > std::abs(Matrix[Pivot * Size_ + k]))
+					Pivot = i;
+			if (Matrix[Pivot * Size_ + k] == 0)
+				return false;
+			Pivots[k] = Pivot;
+			if (Pivot != k)
+				for (unsigned j = 0; j < Size_; ++j)
+					std::swap(Matrix[k * Size_ + j], Matrix[Pivot * Size_ + j]);
+			for (unsigned i = k + 1; i < Size_; ++i)
+			{
+				T Factor = Matrix[i * Size_ + k] /= Matrix[k * Size_ + k];
+				for (unsigned j = k + 1; j < Size_; ++j)
+					Matrix[i * Size_ + j] -= Factor * Matrix[k * Size_ + j];
+			}
+		}
+		return true;
+	}
+
+	static void solve(const StageMatrix &Matrix, const std::array<unsigned, Size_> &Pivots, StageVector &Vector)
+	{
+		for (unsigned k = 0; k < Size_; ++k)
+			std::swap(Vector[k], Vector[Pivots[k]]);
+		for (unsigned k = 0; k < Size_; ++k)
+			for (unsigned i = k + 1; i < Size_; ++i)
+				Vector[i] -= Matrix[i * Size_ + k] * Vector[k];
+		for (unsigned k = Size_; k-- > 0;)
+		{
+			for (unsigned j = k + 1; j < Size_; ++j)
+				Vector[k] -= Matrix[k * Size_ + j] * Vector[j];
+			Vector[k] /= Matrix[k * Size_ + k];
 		}
-		return K0;
 	}
 };
 
 
+//--------------------------------------------AdamsBashforthMoultonSolver---------------------------------------------------------
+
+/**
+ * @brief class AdamsBashforthMoultonSolver - solves the Equation_ using the Adams-Bashforth-Moulton predictor-corrector method
+ *                                            of the orders 2-5 in the PECE mode: a step costs two derivative evaluations
+ *                                            instead of the four of RungeKutta. With the backward differences of the derivatives
+ *
+ *                                  Predicted = K0 + DeltaT * (G_0 f_n + G_1 nabla f_n + ... + G_(Order-2) nabla^(Order-2) f_n),
+ *                                  K1        = Predicted + DeltaT * G_(Order-1) nabla^(Order-1) f_(n+1),
+ *
+ *              where f_(n+1) is the derivative in the Predicted state and G are the Adams-Bashforth coefficients.
+ *              After every step the order changes by one, if the next term G_q nabla^q f_(n+1), which estimates the error
+ *              of the order q, is smaller for the neighbour order. So the order drops if the step is too large for
+ *              the higher differences to decrease.
+ *              The History keeps the backward differences of the last MaxOrder_ derivatives in a fixed array
+ *              and updates them in place, the first MaxOrder_ - 1 steps are made by the RungeKuttaSolver.
+ *              A resumed run starts the history again, so it continues the trajectory to the accuracy of the method, not exactly.
+ */
+template <typename T, unsigned Dim, typename Model = DiffEquation<T, Dim>>
+class AdamsBashforthMoultonSolver : public StaticSolver<T, Dim, Model>
+{
+	static constexpr std::size_t MinOrder_ = 2;
+	static constexpr std::size_t MaxOrder_ = 5;
+	static constexpr T Gamma_[MaxOrder_ + 1] = {T(1), T(1) / 2, T(5) / 12, T(3) / 8, T(251) / 720, T(95) / 288};
+
+	/**
+	 * @brief struct History - Nabla[j] is the j-th backward difference of the derivatives in the last Size states,
+	 *                         Order is the current order of the method
+	 */
+	struct History
+	{
+		std::array<Coordinates<T, Dim>, MaxOrder_> Nabla;
+		std::size_t Size = 0;
+		std::size_t Order = MaxOrder_;
+
+		void push(const Coordinates<T, Dim> &Derivative)
+		{
+			Coordinates<T, Dim> Previous = Nabla[0];
+			Nabla[0] = Derivative;
+			for (std::size_t j = 1; j < std::min(Size + 1, MaxOrder_); ++j)
+			{
+				Coordinates<T, Dim> Difference = Nabla[j];
+				Nabla[j] = Nabla[j - 1] - Previous;
+				Previous = Difference;
+			}
+			Size = std::min(Size + 1, MaxOrder_);
+		}
+	};
+
+	T DeltaT_;
+	RungeKuttaSolver<T, Dim, Model> RungeKutta_;
+
+public:
+	AdamsBashforthMoultonSolver(const Model &Equation, T DeltaT = 0.01) : 
+	StaticSolver<T, Dim, Model>(Equation), DeltaT_(DeltaT), RungeKutta_(Equation, DeltaT) {};
+	const std::basic_string_view<char> getName() const override { return magic_enum::enum_name(Solvers::AdamsBashforthMoulton); }
+
+	void streamTrajectory(Coordinates<T, Dim> StartCoords, TimeRange<T> Range, TrajectorySink<T, Dim> &Sink) override
+	{
+		History Past;
+		Solver<T, Dim>::march(getStart(StartCoords, Range.DeltaT), Range, Sink, 
+		                      [this, &Past](const Coordinates<T, Dim> &K0, T DeltaT) { return makeStep(K0, Past, DeltaT); });
+	}
+
+	Coordinates<T, Dim> getStart(Coordinates<T, Dim> StartCoords, T DeltaT) const
+	{
+		History Past;
+		return Solver<T, Dim>::warmUp(StartCoords, DeltaT, 
+		                              [this, &Past](const Coordinates<T, Dim> &K0, T DeltaT) { return makeStep(K0, Past, DeltaT); });
+	}
+
+	/**
+	 * @brief makeStep - Past holds the differences of the derivatives up to K0 and gets the derivative in the returned state
+	 */
+	Coordinates<T, Dim> makeStep(const Coordinates<T, Dim> &K0, History &Past, T DeltaT) const
+	{
+		const Model &Equation = StaticSolver<T, Dim, Model>::Model_;
+		if (Past.Size == 0)
+			Past.push(Equation.getDerivative(K0));
+		if (Past.Size < MaxOrder_)
+		{
+			Coordinates<T, Dim> K1 = RungeKutta_.makeStep(K0, DeltaT);
+			Past.push(Equation.getDerivative(K1));
+			return K1;
+		}
+
+		switch (Past.Order)
+		{
+			case 2:  return correct<2>(K0, Past, DeltaT);
+			case 3:  return correct<3>(K0, Past, DeltaT);
+			case 4:  return correct<4>(K0, Past, DeltaT);
+			default: return correct<5>(K0, Past, DeltaT);
+		}
+	}
+
+private:
+	// The step of the given Order, which is a template parameter, so the loops over the differences are unrolled
+	template <std::size_t Order>
+	Coordinates<T, Dim> correct(const Coordinates<T, Dim> &K0, History &Past, T DeltaT) const
+	{
+		const Model &Equation = StaticSolver<T, Dim, Model>::Model_;
+		Coordinates<T, Dim> Sum = Gamma_[0] * Past.Nabla[0];
+		for (std::size_t j = 1; j + 1 < Order; ++j)
+			Sum += Gamma_[j] * Past.Nabla[j];
+		Coordinates<T, Dim> Predicted = K0 + DeltaT * Sum;
+		// The derivative of the time is 1 and its differences are 0, so this is the same time, 
+		// but it doesn't wait for the derivative in the last state and the time dependent force is calculated in advance
+		Predicted[0] = K0[0] + DeltaT;
+
+		// Differences of the derivatives with f_(n+1), the highest one is only for the error estimate of the order MaxOrder_
+		std::array<Coordinates<T, Dim>, MaxOrder_ + 1> Nabla;
+		Nabla[0] = Equation.getDerivative(Predicted);
+		for (std::size_t j = 1; j <= MaxOrder_; ++j)
+			Nabla[j] = Nabla[j - 1] - Past.Nabla[j - 1];
+		Coordinates<T, Dim> K1 = Predicted + DeltaT * Gamma_[Order - 1] * Nabla[Order - 1];
+		K1[0] = Predicted[0];
+
+		T MinError = std::numeric_limits<T>::max();
+		for (std::size_t q = std::min(Order + 1, MaxOrder_); q + 1 >= Order && q >= MinOrder_; --q)
+		{
+			T Error = Gamma_[q] * linalg::maxelem(linalg::abs(Nabla[q]));
+			if (Error < MinError)
+			{
+				MinError   = Error;
+				Past.Order = q;
+			}
+		}
+
+		// The derivative in K1 replaces the predicted one, every difference changes by the same correction
+		Coordinates<T, Dim> Correction = Equation.getDerivative(K1) - Nabla[0];
+		for (std::size_t j = 0; j < MaxOrder_; ++j)
+			Past.Nabla[j] = Nabla[j] + Correction;
+		return K1;
+	}
+};
+
 #endif // SOLVER_H
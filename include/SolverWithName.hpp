@@ -2,48 +2,280 @@
 #define SOLVER_WITH_NAME_H
 
 
-#include "Solver.hpp"
+#include "Observable.hpp"
+#include "TrajectoryFile.hpp"
+#include "json.hpp"
 
 
 
 
-template <typename T, unsigned Dim>
+//------------------------------------------------EventCondition-------------------------------------------------------------------
+
+enum class Events
+{
+	XZero,
+	VZero,
+	Energy
+};
+
+/**
+ * @brief struct EventCondition - the event of the trajectory: X crosses zero (XZero), V crosses zero at the turning points (VZero)
+ *                                or the energy crosses the Level (Energy). Direction and TerminateAfter are as in the EventFunction.
+ */
+template <typename T>
+struct EventCondition
+{
+	Events Event = Events::XZero;
+	int Direction = 0;
+	std::size_t TerminateAfter = 0;
+	T Level = 0;
+};
+
+//--------------------------------------------------Observables-------------------------------------------------------------------
+
+// The energy is written always, the other observables only if they are asked for
+enum class Observables
+{
+	Energy,
+	X,
+	V,
+	Phase
+};
+
+//------------------------------------------------SolverWithName-------------------------------------------------------------------
+
+/**
+ * @brief struct SolverWithName - writes the trajectory of the Solver to the files named by the solver and the equation.
+ *                                The records are stored as Stored, so the trajectory calculated in double
+ *                                can be written in float (the mixed precision).
+ */
+template <typename T, unsigned Dim, typename Stored = T>
 struct SolverWithName
 {
 	const std::string SolverName_;
 	const std::string EquationName_;
+	// Prefix of the output files
+	const std::string FileName_;
 	Solver<T, Dim> &Solver_;
+	// Checkpoint is written every CheckpointEvery_ output records and at the end, if CheckpointEvery_ isn't 0
+	std::size_t CheckpointEvery_ = 0;
+	// Continue from the checkpoint, if it exists
+	bool Resume_ = false;
+	// Events are written to FileName_Events.bin by writeSolutionAndEnergy
+	std::vector<EventCondition<T>> Events_;
+	// Every observable is written to FileName_Name.bin, their statistics to FileName_Observables.json, if the list isn't empty
+	std::vector<Observables> Observables_;
 
-	SolverWithName(const std::string SolverName, const std::string EquationName, Solver<T, Dim> &Solver) :
-	SolverName_(SolverName), EquationName_(EquationName), Solver_(Solver) {};
+	SolverWithName(const std::string SolverName, const std::string EquationName, Solver<T, Dim> &Solver, const std::string FileName = "") :
+	SolverName_(SolverName), EquationName_(EquationName), FileName_(FileName.empty() ? SolverName + EquationName : FileName), Solver_(Solver) {};
 
+	/**
+	 * @brief writeSolution - calculates the trajectory in memory and writes it with its energy and observables in one pass
+	 */
 	void writeSolution(Coordinates<T, Dim> StartCoords, TimeRange<T> Range)
 	{
-		if (SolverName_ == "Analitic")
-			static_cast<AnalyticalSolver<T, Dim>&>(Solver_).setConstants(StartCoords);
-	
 		Solver_.calculateTrajectory(StartCoords, Range);
 
-		std::string FileSolutionName = SolverName_ + EquationName_ + ".bin";
-		std::ofstream FileSolution(FileSolutionName, std::ios::binary);
-		Solver_.writeSolution(FileSolution);
+		TrajectoryFileSink<T, Dim, Stored> SolutionSink(FileName_ + ".bin", makeHeader(Dim, Range));
+		ObservableFiles Files;
+		ObservableSink<T, Dim> Observables = makeObservableSink(Files, makeHeader(2, Range));
+		TeeSink<T, Dim> OutputSink(SolutionSink, Observables);
+		pushTrajectory(OutputSink);
+		writeStatistics(Observables);
 	}
 
-	void writeEnergy() const
+	void setCheckpoint(std::size_t CheckpointEvery, bool Resume)
 	{
-		if (!Solver_.isCalculated())
-			throw std::logic_error("You must first writeSolution before calculating the energy");
-		std::string FileEnergyName = SolverName_ + EquationName_ + "Energy.bin";
-		std::ofstream FileEnergy(FileEnergyName, std::ios::binary);
-		Solver_.writeEnergy(FileEnergy);
+		CheckpointEvery_ = CheckpointEvery;
+		Resume_          = Resume;
 	}
 
-	void writeSolutionAndEnergy(Coordinates<T, Dim> &StartCoords, TimeRange<T> &Range)
+	void setEvents(std::vector<EventCondition<T>> Events) { Events_ = std::move(Events); }
+
+	/**
+	 * @brief writeSolutionAndEnergy - writes the solution, its energy and the Observables_ to the files while the trajectory is calculated,
+	 *                                 without storing it in memory. Only every OutputEvery-th state is written.
+	 *                                 If OutputStep isn't 0, the states are interpolated by the HermiteSink 
+	 *                                 to the times OutputStep apart, independent of the steps of the solver.
+	 *                                 If Resume_ and the checkpoint FileName_.ckpt exists, the run continues from it to Range.Stop
+	 *                                 and the records are appended to the files.
+	 *                                 The Events_ found by the EventSink are written to FileName_Events.bin,
+	 *                                 a terminal event stops the run before Range.Stop.
+	 *                                 The events and the Observables_ aren't saved in the checkpoint, so they can't be used with it.
+	 */
+	void writeSolutionAndEnergy(Coordinates<T, Dim> &StartCoords, TimeRange<T> &Range, std::size_t OutputEvery = 1, T OutputStep = 0)
 	{
 		if ((EquationName_ == "Phys") && (SolverName_ == "Analitic"))
 			return;
-		writeSolution(StartCoords, Range);
-		writeEnergy();
+		TimeRange<T> OutputRange = Range;
+		OutputRange.DeltaT *= OutputEvery;
+		bool Uniform = Solver_.isFixedStep();
+		if (OutputStep > 0)
+		{
+			if (OutputEvery != 1 || CheckpointEvery_ > 0 || Resume_)
+				throw std::logic_error("OutputStep can't be used together with OutputEvery, checkpoints or resume");
+			OutputRange.DeltaT = OutputStep;
+			Uniform = true;
+		}
+		if (!Events_.empty() && (CheckpointEvery_ > 0 || Resume_))
+			throw std::logic_error("Events can't be used together with checkpoints or resume");
+		// The checkpoint has only the state of the solver, the phase unwrapping and the statistics would start again on resume
+		if (!Observables_.empty() && (CheckpointEvery_ > 0 || Resume_))
+			throw std::logic_error("Observables can't be used together with checkpoints or resume");
+		const std::string CheckpointName = FileName_ + ".ckpt";
+
+		TrajectoryFileSink<T, Dim, Stored> SolutionSink(FileName_ + ".bin", makeHeader(Dim, OutputRange, Uniform));
+		ObservableFiles Files;
+		ObservableSink<T, Dim> Observables = makeObservableSink(Files, makeHeader(2, OutputRange, Uniform));
+		TrajectoryFileSink<T, Dim + 1, Stored> EventFileSink(FileName_ + "Events.bin", makeHeader(Dim + 1, Range, false));
+		CheckpointHeader Checkpoint{};
+		SolverState<T, Dim> State;
+		if (Resume_ && readCheckpoint(CheckpointName, Checkpoint, State))
+		{
+			if (std::string_view(Checkpoint.Model) != EquationName_ || std::string_view(Checkpoint.Solver) != SolverName_ || 
+			    Checkpoint.OutputEvery != OutputEvery)
+				throw std::logic_error("Checkpoint " + CheckpointName + " was written by another model, solver or OutputEvery");
+			SolutionSink.appendTo(Checkpoint.SolutionRecords);
+			// All observables have a record for every output state, as the energy
+			for (auto &File : Files)
+				File->appendTo(Checkpoint.EnergyRecords);
+			Solver_.resumeFrom(State);
+		}
+		TeeSink<T, Dim> OutputSink(SolutionSink, Observables);
+		DecimatingSink<T, Dim> Sink(OutputSink, OutputEvery, Checkpoint.Phase);
+		std::optional<HermiteSink<T, Dim>> DenseSink;
+		if (OutputStep > 0)
+			DenseSink.emplace(OutputSink, Solver_.getEquation(), OutputStep, Range.Stop - Range.Start);
+		TrajectorySink<T, Dim> *InputSink = DenseSink ? static_cast<TrajectorySink<T, Dim>*>(&*DenseSink) : &Sink;
+		std::optional<EventSink<T, Dim>> EventsSink;
+		std::optional<TeeSink<T, Dim>> EventTee;
+		if (!Events_.empty())
+		{
+			EventsSink.emplace(EventFileSink, Solver_.getEquation(), getEventFunctions());
+			EventTee.emplace(*EventsSink, *InputSink);
+			InputSink = &*EventTee;
+		}
+
+		if (CheckpointEvery_ > 0)
+		{
+			EquationName_.copy(Checkpoint.Model, sizeof(Checkpoint.Model) - 1);
+			SolverName_.copy(Checkpoint.Solver, sizeof(Checkpoint.Solver) - 1);
+			Checkpoint.OutputEvery = OutputEvery;
+			Solver_.setCheckpoint(CheckpointEvery_ * OutputEvery, [&](const SolverState<T, Dim> &State)
+			                      {
+			                      	SolutionSink.flush();
+			                      	for (auto &File : Files)
+			                      		File->flush();
+			                      	Checkpoint.Phase           = Sink.getPhase();
+			                      	Checkpoint.SolutionRecords = SolutionSink.getRecordCount();
+			                      	Checkpoint.EnergyRecords   = Files.front()->getRecordCount();
+			                      	writeCheckpoint(CheckpointName, Checkpoint, State);
+			                      });
+		}
+		Solver_.streamTrajectory(StartCoords, Range, *InputSink);
+		Solver_.setCheckpoint(0, nullptr);
+		writeStatistics(Observables);
+	}
+
+	void setObservables(std::vector<Observables> Observables) { Observables_ = std::move(Observables); }
+
+private:
+	TrajectoryHeader makeHeader(unsigned RecordDim, TimeRange<T> Range) const { return makeHeader(RecordDim, Range, Solver_.isFixedStep()); }
+
+	TrajectoryHeader makeHeader(unsigned RecordDim, TimeRange<T> Range, bool Uniform) const
+	{
+		return makeTrajectoryHeader<T, Stored>(RecordDim, EquationName_, SolverName_, Solver_.getEquation().getParameters(), Range, Uniform);
+	}
+
+	// The first one is the energy
+	using ObservableFiles = std::vector<std::unique_ptr<TrajectoryFileSink<T, 2, Stored>>>;
+
+	/**
+	 * @brief makeObservableSink - the sink of the energy and the Observables_, that writes every one of them 
+	 *                             to the file FileName_Name.bin of the Files with the Header
+	 */
+	ObservableSink<T, Dim> makeObservableSink(ObservableFiles &Files, const TrajectoryHeader &Header) const
+	{
+		const DiffEquation<T, Dim> &Equation = Solver_.getEquation();
+		std::vector<std::unique_ptr<Observable<T, Dim>>> List;
+		List.push_back(std::make_unique<EnergyObservable<T, Dim>>(Equation));
+		for (Observables Kind : Observables_)
+			switch (Kind)
+			{
+				case Observables::Energy:
+					break;
+				case Observables::X:
+					List.push_back(std::make_unique<CoordinateObservable<T, Dim>>("X", 1));
+					break;
+				case Observables::V:
+					List.push_back(std::make_unique<CoordinateObservable<T, Dim>>("V", 2));
+					break;
+				case Observables::Phase:
+					List.push_back(std::make_unique<PhaseObservable<T, Dim>>(Equation.getParameters().W));
+					break;
+			}
+
+		std::vector<TrajectorySink<T, 2>*> Downstreams;
+		for (const auto &Observable : List)
+		{
+			Files.push_back(std::make_unique<TrajectoryFileSink<T, 2, Stored>>(FileName_ + Observable->getName() + ".bin", Header));
+			Downstreams.push_back(Files.back().get());
+		}
+		return ObservableSink<T, Dim>(std::move(List), std::move(Downstreams), !Observables_.empty());
+	}
+
+	/**
+	 * @brief writeStatistics - writes the statistics of the observables to FileName_Observables.json, if Observables_ were asked for
+	 */
+	void writeStatistics(const ObservableSink<T, Dim> &Sink) const
+	{
+		if (Observables_.empty())
+			return;
+		nlohmann::json Statistics;
+		for (std::size_t i = 0; i < Sink.size(); ++i)
+		{
+			const RunningStatistics<T> &Values = Sink.getStatistics(i);
+			Statistics[Sink.getName(i)] = {{"Count", Values.Count}, {"First", Values.First}, {"Last", Values.Last}, 
+			                               {"Min", Values.Min}, {"Max", Values.Max}, {"Mean", Values.getMean()}, 
+			                               {"Rms", Values.getRms()}, {"Drift", Values.getDrift()}};
+		}
+		std::ofstream File(FileName_ + "Observables.json");
+		File << Statistics.dump(4) << "\n";
+		if (!File)
+			throw std::logic_error("Failed to write " + FileName_ + "Observables.json");
+	}
+
+	std::vector<EventFunction<T, Dim>> getEventFunctions() const
+	{
+		std::vector<EventFunction<T, Dim>> Functions;
+		for (const EventCondition<T> &Condition : Events_)
+		{
+			EventFunction<T, Dim> Function{nullptr, Condition.Direction, Condition.TerminateAfter};
+			switch (Condition.Event)
+			{
+				case Events::XZero:
+					Function.Function = [](const Coordinates<T, Dim> &State) { return State[1]; };
+					break;
+				case Events::VZero:
+					Function.Function = [](const Coordinates<T, Dim> &State) { return State[2]; };
+					break;
+				case Events::Energy:
+					Function.Function = [&Equation = Solver_.getEquation(), Level = Condition.Level](const Coordinates<T, Dim> &State)
+					                    { return Equation.getEnergy(State) - Level; };
+					break;
+			}
+			Functions.push_back(std::move(Function));
+		}
+		return Functions;
+	}
+
+	void pushTrajectory(TrajectorySink<T, Dim> &Sink) const
+	{
+		const SequenceOfStates<T, Dim> &Trajectory = Solver_.getTrajectory();
+		Sink.open(Trajectory.size());
+		for (const Coordinates<T, Dim> &State : Trajectory)
+			Sink.push(State);
+		Sink.close();
 	}
 };
 
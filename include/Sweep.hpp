@@ -0,0 +1,158 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+
+#include "Ensemble.hpp"
+
+#include <thread>
+
+
+
+
+template <typename T>
+struct SteadyResponse
+{
+	T W0;
+	// Amplitude and phase lag of the steady oscillations X = A cos(W0 t - Phi)
+	T A;
+	T Phi;
+	bool IsSteady;
+};
+
+//-------------------------------------------------ResponseSweep-------------------------------------------------------------------
+
+/**
+ * @brief class ResponseSweep - calculates the amplitude-frequency response (ACHH) of the DrivenOscillatorEquation
+ *                              with the driving force F cos(W0 t) for a list of frequencies W0.
+ *
+ *              The frequencies are split between threads, every thread integrates its part in one EnsembleSolver.
+ *              The steady oscillations are measured by the lock-in method: over a window of SteadyPeriods_
+ *              driving periods
+ *                                  a = 2 / Tw * Integral(X cos(W0 t) dt),   b = 2 / Tw * Integral(X sin(W0 t) dt),
+ *
+ *                                  A = sqrt(a^2 + b^2),   Phi = atan2(b, a).
+ *
+ *              The oscillations are steady, when A of two successive windows differ less than SteadyTol_ relatively.
+ *              The trajectories are not stored, only the response of each frequency is returned.
+ */
+template <typename T>
+class ResponseSweep
+{
+	ModelParameters<T> Params_;
+	Solvers Method_;
+	T SteadyTol_;
+	unsigned SteadyPeriods_;
+	unsigned Threads_;
+
+public:
+	ResponseSweep(const ModelParameters<T> &Params, Solvers Method = Solvers::RungeKutta, T SteadyTol = 1e-3,
+	              unsigned SteadyPeriods = 5, unsigned Threads = std::thread::hardware_concurrency()) :
+	Params_(Params), Method_(Method), SteadyTol_(SteadyTol), SteadyPeriods_(SteadyPeriods), Threads_(std::max(Threads, 1u))
+	{
+		if (SteadyTol_ <= 0)
+			throw std::logic_error("Tolerance of the steady state must be positive");
+		if (SteadyPeriods_ == 0)
+			throw std::logic_error("Number of periods in the window can't be zero");
+	}
+
+	/**
+	 * @brief calculate - integrates every frequency from StartCoords for at most (Range.Stop - Range.Start)
+	 *                    time units or until its oscillations become steady
+	 */
+	std::vector<SteadyResponse<T>> calculate(const std::vector<T> &Frequencies, Coordinates<T, 3> StartCoords, TimeRange<T> Range) const
+	{
+		for (T W0 : Frequencies)
+			if (W0 <= 0)
+				throw std::logic_error("Frequency of the driving force must be positive");
+
+		std::vector<SteadyResponse<T>> Response(Frequencies.size());
+		std::size_t Threads = std::min<std::size_t>(Threads_, Frequencies.size());
+		std::size_t Chunk = Threads ? (Frequencies.size() + Threads - 1) / Threads : 0;
+		std::vector<std::thread> Workers;
+		std::vector<std::exception_ptr> Errors(Threads);
+		for (std::size_t i = 0; i < Threads; ++i)
+		{
+			std::size_t Begin = i * Chunk, End = std::min(Begin + Chunk, Frequencies.size());
+			Workers.emplace_back([&, i, Begin, End]()
+			                     {
+			                     	try
+			                     	{
+			                     		calculateChunk(Frequencies, Begin, End, StartCoords, Range, Response);
+			                     	}
+			                     	catch (...)
+			                     	{
+			                     		Errors[i] = std::current_exception();
+			                     	}
+			                     });
+		}
+		for (auto &Worker : Workers)
+			Worker.join();
+		for (auto &Error : Errors)
+			if (Error)
+				std::rethrow_exception(Error);
+		return Response;
+	}
+
+private:
+	void calculateChunk(const std::vector<T> &Frequencies, std::size_t Begin, std::size_t End,
+	                    Coordinates<T, 3> StartCoords, TimeRange<T> Range, std::vector<SteadyResponse<T>> &Response) const
+	{
+		std::size_t N = End - Begin;
+		if (N == 0)
+			return;
+		EnsembleSolver<T> Ensemble(Models::MathWithDriv);
+		Ensemble.reserve(N);
+		for (std::size_t i = Begin; i < End; ++i)
+		{
+			ModelParameters<T> Params = Params_;
+			Params.W0 = Frequencies[i];
+			Ensemble.addOscillator(Params, StartCoords);
+		}
+		Ensemble.warmUp(Method_, Range.DeltaT);
+
+		// Lock-in sums and the window of each lane
+		std::vector<T> SumC(N, 0), SumS(N, 0), Elapsed(N, 0), Window(N), LastA(N, 0);
+		std::vector<unsigned char> Done(N, 0);
+		std::size_t Remaining = N;
+		for (std::size_t i = 0; i < N; ++i)
+		{
+			Window[i] = SteadyPeriods_ * 2 * M_PI / Frequencies[Begin + i];
+			Response[Begin + i] = SteadyResponse<T>{Frequencies[Begin + i], 0, 0, false};
+		}
+
+		T DeltaT = Range.DeltaT;
+		const std::vector<T> &Time = Ensemble.getTime(), &X = Ensemble.getX();
+		for (std::size_t k = 0, Count = getStepCount(Range.Start, Range.Stop, DeltaT); k < Count && Remaining > 0; ++k)
+		{
+			Ensemble.step(Method_, DeltaT);
+			for (std::size_t i = 0; i < N; ++i)
+			{
+				if (Done[i])
+					continue;
+				T Phase = Frequencies[Begin + i] * Time[i];
+				SumC[i]    += X[i] * std::cos(Phase) * DeltaT;
+				SumS[i]    += X[i] * std::sin(Phase) * DeltaT;
+				Elapsed[i] += DeltaT;
+				if (Elapsed[i] < Window[i])
+					continue;
+
+				T C = 2 * SumC[i] / Elapsed[i], S = 2 * SumS[i] / Elapsed[i];
+				T A = std::sqrt(C * C + S * S);
+				SteadyResponse<T> &Result = Response[Begin + i];
+				Result.A   = A;
+				Result.Phi = std::atan2(S, C);
+				if (LastA[i] > 0 && std::abs(A - LastA[i]) <= SteadyTol_ * A)
+				{
+					Result.IsSteady = true;
+					Done[i] = 1;
+					--Remaining;
+				}
+				LastA[i] = A;
+				SumC[i] = SumS[i] = Elapsed[i] = 0;
+			}
+		}
+	}
+};
+
+
+#endif // SWEEP_H
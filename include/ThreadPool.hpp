@@ -0,0 +1,173 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+
+
+//---------------------------------------------------ThreadPool--------------------------------------------------------------------
+
+/**
+ * @brief class ThreadPool - fixed set of workers with a task queue per worker.
+ *                           A worker takes tasks from the back of its own queue and, when it is empty,
+ *                           steals from the front of the other queues, so long tasks don't leave cores idle.
+ *                           Tasks submitted from a worker go to its own queue, the others are distributed round-robin.
+ */
+class ThreadPool
+{
+	using Task = std::function<void()>;
+
+	struct WorkerQueue
+	{
+		std::mutex Mutex;
+		std::deque<Task> Tasks;
+	};
+
+	std::vector<std::unique_ptr<WorkerQueue>> Queues_;
+	std::vector<std::thread> Workers_;
+
+	std::mutex Mutex_;
+	std::condition_variable HasWork_;
+	std::condition_variable AllDone_;
+	// Tasks submitted but not finished yet
+	std::size_t Pending_ = 0;
+	// Tasks in the queues, changed under Mutex_ so that the workers don't miss a wake-up
+	std::size_t Queued_ = 0;
+	bool Stop_ = false;
+	// The first exception thrown by a task, rethrown by wait
+	std::exception_ptr Error_;
+	std::atomic<std::size_t> NextQueue_{0};
+
+	static thread_local ThreadPool *CurrentPool_;
+	static thread_local std::size_t CurrentWorker_;
+
+public:
+	ThreadPool(unsigned Threads = std::thread::hardware_concurrency())
+	{
+		Threads = std::max(Threads, 1u);
+		for (unsigned i = 0; i < Threads; ++i)
+			Queues_.push_back(std::make_unique<WorkerQueue>());
+		for (unsigned i = 0; i < Threads; ++i)
+			Workers_.emplace_back([this, i]() { work(i); });
+	}
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> Lock(Mutex_);
+			Stop_ = true;
+		}
+		HasWork_.notify_all();
+		for (auto &Worker : Workers_)
+			Worker.join();
+	}
+
+	std::size_t size() const { return Workers_.size(); }
+
+	void submit(Task NewTask)
+	{
+		std::size_t Queue = (CurrentPool_ == this) ? CurrentWorker_ : NextQueue_++ % Queues_.size();
+		{
+			// The task is counted before it is pushed, so a worker can't take it and decrement Queued_ before it is counted
+			std::lock_guard<std::mutex> Lock(Mutex_);
+			++Pending_;
+			++Queued_;
+		}
+		{
+			std::lock_guard<std::mutex> Lock(Queues_[Queue]->Mutex);
+			Queues_[Queue]->Tasks.push_back(std::move(NewTask));
+		}
+		HasWork_.notify_one();
+	}
+
+	// Waits until all submitted tasks are finished, must not be called from a task
+	void wait()
+	{
+		std::unique_lock<std::mutex> Lock(Mutex_);
+		AllDone_.wait(Lock, [this]() { return Pending_ == 0; });
+		if (Error_)
+			std::rethrow_exception(std::exchange(Error_, nullptr));
+	}
+
+private:
+	void work(std::size_t Worker)
+	{
+		CurrentPool_   = this;
+		CurrentWorker_ = Worker;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> Lock(Mutex_);
+				HasWork_.wait(Lock, [this]() { return Stop_ || Queued_ > 0; });
+				if (Queued_ == 0)
+					return;
+			}
+
+			Task Current;
+			if (!takeTask(Worker, Current))
+				continue;
+			std::exception_ptr Error;
+			try
+			{
+				Current();
+			}
+			catch (...)
+			{
+				Error = std::current_exception();
+			}
+
+			std::lock_guard<std::mutex> Lock(Mutex_);
+			if (Error && !Error_)
+				Error_ = Error;
+			if (--Pending_ == 0)
+				AllDone_.notify_all();
+		}
+	}
+
+	bool takeTask(std::size_t Worker, Task &Current)
+	{
+		for (std::size_t i = 0; i < Queues_.size(); ++i)
+		{
+			std::size_t Victim = (Worker + i) % Queues_.size();
+			WorkerQueue &Queue = *Queues_[Victim];
+			std::lock_guard<std::mutex> Lock(Queue.Mutex);
+			if (Queue.Tasks.empty())
+				continue;
+			// Own tasks are taken LIFO, stolen ones FIFO
+			if (Victim == Worker)
+			{
+				Current = std::move(Queue.Tasks.back());
+				Queue.Tasks.pop_back();
+			}
+			else
+			{
+				Current = std::move(Queue.Tasks.front());
+				Queue.Tasks.pop_front();
+			}
+			std::lock_guard<std::mutex> CountLock(Mutex_);
+			--Queued_;
+			return true;
+		}
+		return false;
+	}
+};
+
+inline thread_local ThreadPool *ThreadPool::CurrentPool_ = nullptr;
+inline thread_local std::size_t ThreadPool::CurrentWorker_ = 0;
+
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,390 @@
+#ifndef TRAJECTORY_FILE_H
+#define TRAJECTORY_FILE_H
+
+
+#include "Solver.hpp"
+
+#include <cstdint>
+#include <fcntl.h>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+
+
+//------------------------------------------------TrajectoryHeader-----------------------------------------------------------------
+
+/**
+ * @brief struct TrajectoryHeader - header of the trajectory file (version 1).
+ *
+ *              File layout:  [TrajectoryHeader, 256 bytes]
+ *                            [RecordCount records of Dim scalars of ScalarSize bytes, the first scalar is the time]
+ *                            [zero padding to the alignment of the TrajectoryIndexEntry]
+ *                            [IndexCount TrajectoryIndexEntry: time of every IndexStride-th record]
+ *
+ *              All fields are little-endian, the parameters and the time range are stored as double
+ *              regardless of the scalar type of the records.
+ */
+struct TrajectoryHeader
+{
+	static constexpr char          MagicValue[8] = "HSIMTRJ";
+	static constexpr std::uint32_t CurrentVersion = 1;
+
+	char          Magic[8];
+	std::uint32_t Version;
+	std::uint32_t ScalarSize;
+	std::uint32_t Dim;
+	// 1 if the records are exactly DeltaT apart in time
+	std::uint32_t Uniform;
+	char          Model[32];
+	char          Solver[32];
+	double        W, G, F, W0;
+	double        Start, Stop, DeltaT;
+	std::uint64_t RecordCount;
+	std::uint64_t DataOffset;
+	std::uint64_t IndexOffset;
+	std::uint64_t IndexCount;
+	std::uint64_t IndexStride;
+	char          Reserved[72];
+};
+
+static_assert(sizeof(TrajectoryHeader) == 256, "TrajectoryHeader must be 256 bytes");
+
+struct TrajectoryIndexEntry
+{
+	double        Time;
+	std::uint64_t Record;
+};
+
+/**
+ * @brief makeTrajectoryHeader - header of the file with the records of Dim scalars of the type Stored
+ */
+template <typename T, typename Stored = T>
+TrajectoryHeader makeTrajectoryHeader(unsigned Dim, std::string_view Model, std::string_view Solver,
+                                      const ModelParameters<T> &Params, TimeRange<T> Range, bool Uniform)
+{
+	TrajectoryHeader Header{};
+	std::memcpy(Header.Magic, TrajectoryHeader::MagicValue, sizeof(Header.Magic));
+	Header.Version    = TrajectoryHeader::CurrentVersion;
+	Header.ScalarSize = sizeof(Stored);
+	Header.Dim        = Dim;
+	Header.Uniform    = Uniform;
+	Model.copy(Header.Model, sizeof(Header.Model) - 1);
+	Solver.copy(Header.Solver, sizeof(Header.Solver) - 1);
+	Header.W      = Params.W;
+	Header.G      = Params.G;
+	Header.F      = Params.F;
+	Header.W0     = Params.W0;
+	Header.Start  = Range.Start;
+	Header.Stop   = Range.Stop;
+	Header.DeltaT = Range.DeltaT;
+	Header.DataOffset = sizeof(TrajectoryHeader);
+	return Header;
+}
+
+//-----------------------------------------------TrajectoryFileSink----------------------------------------------------------------
+
+/**
+ * @brief class TrajectoryFileSink - writes the states to the self-describing trajectory file.
+ *                                   The records are written by the AsyncFileWriter as they are produced,
+ *                                   the time index and the final header are written on close.
+ *                                   The states are stored as the Stored scalars, e.g. the float records
+ *                                   of the trajectory calculated in double take half of the disk and memory.
+ */
+template <typename T, unsigned Dim, typename Stored = T>
+class TrajectoryFileSink : public TrajectorySink<T, Dim>
+{
+	using StoredState = Coordinates<Stored, Dim>;
+
+	std::string FileName_;
+	TrajectoryHeader Header_;
+	std::vector<TrajectoryIndexEntry> Index_;
+	std::unique_ptr<AsyncFileWriter> File_;
+	std::optional<std::uint64_t> AppendAfter_;
+
+public:
+	static constexpr std::uint64_t DefaultIndexStride = 1024;
+
+	TrajectoryFileSink(const std::string &FileName, const TrajectoryHeader &Header, std::uint64_t IndexStride = DefaultIndexStride) :
+	FileName_(FileName), Header_(Header)
+	{
+		if (Header_.Dim != Dim || Header_.ScalarSize != sizeof(Stored))
+			throw std::logic_error("Header of " + FileName + " doesn't match the records");
+		if (IndexStride == 0)
+			throw std::logic_error("Index stride can't be zero");
+		Header_.IndexStride = IndexStride;
+	}
+
+	/**
+	 * @brief appendTo - the next open keeps the first Records records of the existing file and appends the new ones after them.
+	 *                   The rest of the file (the records written after the checkpoint and the index) is dropped.
+	 */
+	void appendTo(std::uint64_t Records) { AppendAfter_ = Records; }
+
+	void open(std::size_t ExpectedStates) override
+	{
+		Index_.clear();
+		Index_.reserve(ExpectedStates / Header_.IndexStride + 1);
+		Header_.RecordCount = 0;
+		if (AppendAfter_)
+		{
+			reopen(*AppendAfter_);
+			AppendAfter_.reset();
+			return;
+		}
+		File_ = std::make_unique<AsyncFileWriter>(FileName_);
+		// The header is rewritten on close, when the number of records is known
+		File_->write(Header_);
+	}
+
+	void push(const Coordinates<T, Dim> &State) override
+	{
+		if (Header_.RecordCount % Header_.IndexStride == 0)
+			Index_.push_back(TrajectoryIndexEntry{static_cast<double>(State[0]), Header_.RecordCount});
+		if constexpr (std::is_same_v<Stored, T>)
+			File_->write(State);
+		else
+			File_->write(StoredState(State));
+		++Header_.RecordCount;
+	}
+
+	void close() override
+	{
+		if (!File_)
+			return;
+		// The records of 3 floats end at a multiple of 4, the index is aligned, so the MappedTrajectory can point into it
+		std::uint64_t DataEnd = Header_.DataOffset + Header_.RecordCount * sizeof(StoredState);
+		constexpr std::uint64_t IndexAlignment = alignof(TrajectoryIndexEntry);
+		Header_.IndexOffset = (DataEnd + IndexAlignment - 1) / IndexAlignment * IndexAlignment;
+		Header_.IndexCount  = Index_.size();
+		const char Padding[IndexAlignment] = {};
+		File_->write(Padding, Header_.IndexOffset - DataEnd);
+		File_->write(Index_.data(), Index_.size() * sizeof(TrajectoryIndexEntry));
+		File_->close();
+		File_.reset();
+
+		std::fstream File(FileName_, std::ios::binary | std::ios::in | std::ios::out);
+		File.write((const char *)(&Header_), sizeof(Header_));
+		if (!File)
+			throw std::logic_error("Failed to write the header of " + FileName_);
+	}
+
+	// Passes all records pushed so far to the file
+	void flush()
+	{
+		if (File_)
+			File_->flush();
+	}
+
+	std::uint64_t getRecordCount() const { return Header_.RecordCount; }
+
+private:
+	void reopen(std::uint64_t Records)
+	{
+		std::ifstream File(FileName_, std::ios::binary);
+		TrajectoryHeader Existing;
+		if (!File.read((char *)(&Existing), sizeof(Existing)) || 
+		    std::memcmp(Existing.Magic, TrajectoryHeader::MagicValue, sizeof(Existing.Magic)) != 0)
+			throw std::logic_error("Can't append to " + FileName_ + ", it is not a trajectory file");
+		if (Existing.Version != Header_.Version || Existing.Dim != Dim || Existing.ScalarSize != sizeof(Stored) ||
+		    std::strncmp(Existing.Model, Header_.Model, sizeof(Header_.Model)) != 0 ||
+		    std::strncmp(Existing.Solver, Header_.Solver, sizeof(Header_.Solver)) != 0)
+			throw std::logic_error("Can't append to " + FileName_ + ", it has another model, solver or records");
+		std::uint64_t DataEnd = Existing.DataOffset + Records * sizeof(StoredState);
+		if (std::filesystem::file_size(FileName_) < DataEnd)
+			throw std::logic_error("Can't append to " + FileName_ + ", it has less records than the checkpoint");
+
+		// The index of the kept records is rebuilt from their times
+		for (std::uint64_t Record = 0; Record < Records; Record += Header_.IndexStride)
+		{
+			StoredState State;
+			File.seekg(Existing.DataOffset + Record * sizeof(State));
+			File.read((char *)(&State), sizeof(State));
+			Index_.push_back(TrajectoryIndexEntry{static_cast<double>(State[0]), Record});
+		}
+		if (!File)
+			throw std::logic_error("Failed to read " + FileName_);
+		File.close();
+
+		// The file covers the time from the start of the first run
+		Header_.Start       = Existing.Start;
+		Header_.Uniform     = Header_.Uniform && Existing.Uniform && Header_.DeltaT == Existing.DeltaT;
+		Header_.DataOffset  = Existing.DataOffset;
+		Header_.RecordCount = Records;
+		std::filesystem::resize_file(FileName_, DataEnd);
+		File_ = std::make_unique<AsyncFileWriter>(FileName_, AsyncFileWriter::DefaultBufferSize, std::ios::app);
+	}
+};
+
+//------------------------------------------------CheckpointHeader-----------------------------------------------------------------
+
+/**
+ * @brief struct CheckpointHeader - header of the checkpoint file, that is followed by the SolverState<T, Dim>.
+ *                                  SolutionRecords and EnergyRecords are the numbers of records in the output files
+ *                                  written before the checkpoint, Phase is the phase of the decimation by OutputEvery.
+ */
+struct CheckpointHeader
+{
+	static constexpr char          MagicValue[8] = "HSIMCKP";
+	// 2: the SolverState has the step counter and the compensation, 3: and the value carried between the steps
+	static constexpr std::uint32_t CurrentVersion = 3;
+
+	char          Magic[8];
+	std::uint32_t Version;
+	std::uint32_t ScalarSize;
+	std::uint32_t Dim;
+	std::uint32_t Reserved0;
+	char          Model[32];
+	char          Solver[32];
+	std::uint64_t OutputEvery;
+	std::uint64_t Phase;
+	std::uint64_t SolutionRecords;
+	std::uint64_t EnergyRecords;
+};
+
+/**
+ * @brief writeCheckpoint - the checkpoint is written to a temporary file, that replaces the old one,
+ *                          so a run killed while writing leaves the previous checkpoint intact
+ */
+template <typename T, unsigned Dim>
+void writeCheckpoint(const std::string &FileName, CheckpointHeader Header, const SolverState<T, Dim> &State)
+{
+	std::memcpy(Header.Magic, CheckpointHeader::MagicValue, sizeof(Header.Magic));
+	Header.Version    = CheckpointHeader::CurrentVersion;
+	Header.ScalarSize = sizeof(T);
+	Header.Dim        = Dim;
+
+	std::string TemporaryName = FileName + ".tmp";
+	{
+		std::ofstream File(TemporaryName, std::ios::binary | std::ios::trunc);
+		File.write((const char *)(&Header), sizeof(Header));
+		File.write((const char *)(&State), sizeof(State));
+		if (!File)
+			throw std::logic_error("Failed to write the checkpoint " + TemporaryName);
+	}
+	std::filesystem::rename(TemporaryName, FileName);
+}
+
+/**
+ * @brief readCheckpoint - false if there is no checkpoint file
+ */
+template <typename T, unsigned Dim>
+bool readCheckpoint(const std::string &FileName, CheckpointHeader &Header, SolverState<T, Dim> &State)
+{
+	std::ifstream File(FileName, std::ios::binary);
+	if (!File.is_open())
+		return false;
+	File.read((char *)(&Header), sizeof(Header));
+	File.read((char *)(&State), sizeof(State));
+	if (!File || std::memcmp(Header.Magic, CheckpointHeader::MagicValue, sizeof(Header.Magic)) != 0)
+		throw std::logic_error(FileName + " is not a checkpoint file");
+	if (Header.Version != CheckpointHeader::CurrentVersion || Header.ScalarSize != sizeof(T) || Header.Dim != Dim)
+		throw std::logic_error("Checkpoint " + FileName + " has another version or type");
+	return true;
+}
+
+//------------------------------------------------MappedTrajectory-----------------------------------------------------------------
+
+/**
+ * @brief class MappedTrajectory - read-only view of the trajectory file mapped into memory.
+ *                                 The records are not copied, any record or time can be found without reading the whole file.
+ */
+template <typename T, unsigned Dim>
+class MappedTrajectory
+{
+	const char *Data_ = nullptr;
+	std::size_t Size_ = 0;
+	const TrajectoryHeader     *Header_  = nullptr;
+	const Coordinates<T, Dim>  *Records_ = nullptr;
+	const TrajectoryIndexEntry *Index_   = nullptr;
+
+public:
+	MappedTrajectory(const std::string &FileName)
+	{
+		int Descriptor = ::open(FileName.c_str(), O_RDONLY);
+		if (Descriptor < 0)
+			throw std::logic_error("Can't open file " + FileName);
+		struct stat Stat;
+		if (fstat(Descriptor, &Stat) != 0 || static_cast<std::size_t>(Stat.st_size) < sizeof(TrajectoryHeader))
+		{
+			::close(Descriptor);
+			throw std::logic_error(FileName + " is not a trajectory file");
+		}
+		Size_ = Stat.st_size;
+		void *Data = mmap(nullptr, Size_, PROT_READ, MAP_SHARED, Descriptor, 0);
+		::close(Descriptor);
+		if (Data == MAP_FAILED)
+			throw std::logic_error("Can't map file " + FileName);
+		Data_ = static_cast<const char *>(Data);
+
+		Header_ = reinterpret_cast<const TrajectoryHeader *>(Data_);
+		try
+		{
+			validate(FileName);
+		}
+		catch (...)
+		{
+			munmap(const_cast<char *>(Data_), Size_);
+			throw;
+		}
+		Records_ = reinterpret_cast<const Coordinates<T, Dim> *>(Data_ + Header_->DataOffset);
+		Index_   = reinterpret_cast<const TrajectoryIndexEntry *>(Data_ + Header_->IndexOffset);
+	}
+
+	MappedTrajectory(const MappedTrajectory &) = delete;
+	MappedTrajectory &operator=(const MappedTrajectory &) = delete;
+
+	~MappedTrajectory() { munmap(const_cast<char *>(Data_), Size_); }
+
+	const TrajectoryHeader &getHeader() const { return *Header_; }
+	std::size_t size() const { return Header_->RecordCount; }
+	const Coordinates<T, Dim> &operator[](std::size_t Record) const { return Records_[Record]; }
+
+	/**
+	 * @brief findRecord - number of the last record with time not greater than Time (0 if there is no such record).
+	 *                     O(1) for the uniform files, otherwise a binary search in the index and a scan of one stride.
+	 */
+	std::size_t findRecord(T Time) const
+	{
+		if (size() == 0 || Time <= Records_[0][0])
+			return 0;
+		std::size_t Record = 0;
+		if (Header_->Uniform)
+			Record = std::min<std::size_t>((Time - Records_[0][0]) / Header_->DeltaT, size() - 1);
+		else
+		{
+			auto Entry = std::upper_bound(Index_, Index_ + Header_->IndexCount, static_cast<double>(Time),
+			                              [](double Time, const TrajectoryIndexEntry &Entry) { return Time < Entry.Time; });
+			Record = (Entry - 1)->Record;
+		}
+		// Correct the rounding of the uniform estimate and finish the scan after the index entry
+		while (Record > 0 && Records_[Record][0] > Time)
+			--Record;
+		while (Record + 1 < size() && Records_[Record + 1][0] <= Time)
+			++Record;
+		return Record;
+	}
+
+private:
+	void validate(const std::string &FileName) const
+	{
+		if (std::memcmp(Header_->Magic, TrajectoryHeader::MagicValue, sizeof(Header_->Magic)) != 0)
+			throw std::logic_error(FileName + " is not a trajectory file");
+		if (Header_->Version != TrajectoryHeader::CurrentVersion)
+			throw std::logic_error("Unsupported version of " + FileName);
+		if (Header_->ScalarSize != sizeof(T) || Header_->Dim != Dim)
+			throw std::logic_error("Records of " + FileName + " have another type");
+		if (Header_->DataOffset % alignof(Coordinates<T, Dim>) != 0 || Header_->IndexOffset % alignof(TrajectoryIndexEntry) != 0)
+			throw std::logic_error("Records or index of " + FileName + " are misaligned");
+		if (Header_->DataOffset + Header_->RecordCount * sizeof(Coordinates<T, Dim>) > Size_ ||
+		    Header_->IndexOffset + Header_->IndexCount * sizeof(TrajectoryIndexEntry) > Size_)
+			throw std::logic_error(FileName + " is truncated");
+	}
+};
+
+
+#endif // TRAJECTORY_FILE_H
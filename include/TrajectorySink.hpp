@@ -0,0 +1,461 @@
+#ifndef TRAJECTORY_SINK_H
+#define TRAJECTORY_SINK_H
+
+
+#include "DiffEquation.hpp"
+#include "AsyncWriter.hpp"
+
+#include <functional>
+
+
+
+
+template <typename T, unsigned Dim>
+using SequenceOfStates = std::vector<Coordinates<T, Dim>>;
+
+//------------------------------------------------TrajectorySink-------------------------------------------------------------------
+
+/**
+ * @brief class TrajectorySink - abstract receiver of the states, that a solver produces one by one.
+ *                               The solver calls open before the first state and close after the last one.
+ *                               The state at the end of the last step isn't a state of the trajectory (the times are before
+ *                               the Stop), it is passed by pushEnd before close, unless the run was stopped by Done_.
+ *                               A sink, that needs no more states, sets Done_ and the solver stops after the state pushed.
+ *                               The flag isn't virtual, so the solvers check it every step for free,
+ *                               the sinks passing the states to other sinks copy it from them after every push.
+ */
+template <typename T, unsigned Dim>
+class TrajectorySink
+{
+protected:
+	bool Done_ = false;
+
+public:
+	virtual ~TrajectorySink() {};
+	// ExpectedStates - estimated number of states, 0 if unknown
+	virtual void open(std::size_t ExpectedStates) {}
+	virtual void push(const Coordinates<T, Dim> &State) = 0;
+	// Only the sinks, that interpolate between the states, use it to reach the Stop
+	virtual void pushEnd(const Coordinates<T, Dim> &State) {}
+	virtual void close() {}
+	bool done() const { return Done_; }
+};
+
+//--------------------------------------------------NullSink-----------------------------------------------------------------------
+
+/**
+ * @brief class NullSink - drops all states, only counts them
+ */
+template <typename T, unsigned Dim>
+class NullSink : public TrajectorySink<T, Dim>
+{
+	std::size_t Count_ = 0;
+
+public:
+	void push(const Coordinates<T, Dim> &State) override { ++Count_; }
+	std::size_t getCount() const { return Count_; }
+};
+
+//-------------------------------------------------MemorySink----------------------------------------------------------------------
+
+/**
+ * @brief class MemorySink - stores all states in the Trajectory_
+ */
+template <typename T, unsigned Dim>
+class MemorySink : public TrajectorySink<T, Dim>
+{
+	SequenceOfStates<T, Dim> &Trajectory_;
+
+public:
+	MemorySink(SequenceOfStates<T, Dim> &Trajectory) : Trajectory_(Trajectory) {};
+
+	void open(std::size_t ExpectedStates) override
+	{
+		Trajectory_.clear();
+		Trajectory_.reserve(ExpectedStates);
+	}
+
+	void push(const Coordinates<T, Dim> &State) override { Trajectory_.push_back(State); }
+};
+
+//----------------------------------------------BoundedMemorySink------------------------------------------------------------------
+
+/**
+ * @brief class BoundedMemorySink - stores only the last Capacity states in a ring buffer
+ */
+template <typename T, unsigned Dim>
+class BoundedMemorySink : public TrajectorySink<T, Dim>
+{
+	SequenceOfStates<T, Dim> Buffer_;
+	std::size_t Capacity_;
+	std::size_t Count_ = 0;
+
+public:
+	BoundedMemorySink(std::size_t Capacity) : Capacity_(Capacity)
+	{
+		if (Capacity_ == 0)
+			throw std::logic_error("Capacity of the BoundedMemorySink can't be zero");
+		Buffer_.reserve(Capacity_);
+	}
+
+	void open(std::size_t ExpectedStates) override
+	{
+		Buffer_.clear();
+		Count_ = 0;
+	}
+
+	void push(const Coordinates<T, Dim> &State) override
+	{
+		if (Buffer_.size() < Capacity_)
+			Buffer_.push_back(State);
+		else
+			Buffer_[Count_ % Capacity_] = State;
+		++Count_;
+	}
+
+	// Stored states in the order they were pushed
+	SequenceOfStates<T, Dim> getTrajectory() const
+	{
+		if (Buffer_.size() < Capacity_)
+			return Buffer_;
+		SequenceOfStates<T, Dim> Trajectory;
+		Trajectory.reserve(Capacity_);
+		for (std::size_t i = 0; i < Capacity_; ++i)
+			Trajectory.push_back(Buffer_[(Count_ + i) % Capacity_]);
+		return Trajectory;
+	}
+};
+
+//--------------------------------------------------FileSink-----------------------------------------------------------------------
+
+/**
+ * @brief class FileSink - writes the states to the binary file as they are produced,
+ *                         the disk I/O is done by the background thread of the AsyncFileWriter
+ */
+template <typename T, unsigned Dim>
+class FileSink : public TrajectorySink<T, Dim>
+{
+	AsyncFileWriter File_;
+
+public:
+	FileSink(const std::string &FileName, std::size_t BufferSize = AsyncFileWriter::DefaultBufferSize) : File_(FileName, BufferSize) {};
+
+	void push(const Coordinates<T, Dim> &State) override { File_.write(State); }
+	void close() override { File_.flush(); }
+};
+
+//------------------------------------------------DecimatingSink-------------------------------------------------------------------
+
+/**
+ * @brief class DecimatingSink - passes every Factor-th state (starting with the first one) to the Downstream sink
+ */
+template <typename T, unsigned Dim>
+class DecimatingSink : public TrajectorySink<T, Dim>
+{
+	TrajectorySink<T, Dim> &Downstream_;
+	std::size_t Factor_;
+	std::size_t Phase_;
+	std::size_t Count_ = 0;
+
+public:
+	// Phase is the number of states, that were dropped after the last passed one before the sink was opened
+	DecimatingSink(TrajectorySink<T, Dim> &Downstream, std::size_t Factor, std::size_t Phase = 0) : 
+	Downstream_(Downstream), Factor_(Factor), Phase_(Phase)
+	{
+		if (Factor_ == 0)
+			throw std::logic_error("Decimation factor can't be zero");
+	}
+
+	void open(std::size_t ExpectedStates) override
+	{
+		Count_ = Phase_;
+		Downstream_.open(ExpectedStates / Factor_ + 1);
+		TrajectorySink<T, Dim>::Done_ = false;
+	}
+
+	void push(const Coordinates<T, Dim> &State) override
+	{
+		if (Count_++ % Factor_ == 0)
+		{
+			Downstream_.push(State);
+			TrajectorySink<T, Dim>::Done_ = Downstream_.done();
+		}
+	}
+
+	void pushEnd(const Coordinates<T, Dim> &State) override { Downstream_.pushEnd(State); }
+	void close() override { Downstream_.close(); }
+	// Number of states dropped after the last passed one
+	std::size_t getPhase() const { return Count_ % Factor_; }
+};
+
+//-------------------------------------------------HermiteSink---------------------------------------------------------------------
+
+/**
+ * @brief interpolateHermite - the state at the Time between the states Y0 and Y1 with the derivatives F0 and F1,
+ *                             the cubic Hermite interpolant
+ *
+ *                                Y(Theta) = (1 - Theta) Y0 + Theta Y1 + Theta (Theta - 1) ((1 - 2 Theta) (Y1 - Y0) + (Theta - 1) H F0 + Theta H F1),
+ *
+ *                             where H = t1 - t0 and Theta = (t - t0) / H. Its error is O(H^4).
+ */
+template <typename T, unsigned Dim>
+Coordinates<T, Dim> interpolateHermite(const Coordinates<T, Dim> &Y0, const Coordinates<T, Dim> &F0, 
+                                       const Coordinates<T, Dim> &Y1, const Coordinates<T, Dim> &F1, T Time)
+{
+	T H = Y1[0] - Y0[0], Theta = (Time - Y0[0]) / H;
+	Coordinates<T, Dim> Y = (1 - Theta) * Y0 + Theta * Y1 + 
+	                        Theta * (Theta - 1) * ((1 - 2 * Theta) * (Y1 - Y0) + (Theta - 1) * H * F0 + Theta * H * F1);
+	Y[0] = Time;
+	return Y;
+}
+
+/**
+ * @brief class HermiteSink - passes the states at the times t0 + k * OutputStep, where t0 is the time of the first state,
+ *                            to the Downstream sink, whatever the steps of the solver are. Between two pushed states 
+ *                            the solution is interpolated by interpolateHermite with the derivatives of the Equation,
+ *                            so a solver of the fourth order can take steps much larger than the output step.
+ *                            A push costs one derivative evaluation.
+ */
+template <typename T, unsigned Dim>
+class HermiteSink : public TrajectorySink<T, Dim>
+{
+	TrajectorySink<T, Dim> &Downstream_;
+	const DiffEquation<T, Dim> &Equation_;
+	T OutputStep_;
+	// Length of the trajectory, the output times reach t0 + Duration_ (if it isn't 0) by pushEnd
+	T Duration_;
+	// Index of the next output time
+	std::size_t Next_ = 0;
+	bool HasPrevious_ = false;
+	T Start_ = 0;
+	Coordinates<T, Dim> Previous_, PreviousDerivative_;
+
+public:
+	HermiteSink(TrajectorySink<T, Dim> &Downstream, const DiffEquation<T, Dim> &Equation, T OutputStep, T Duration = 0) : 
+	Downstream_(Downstream), Equation_(Equation), OutputStep_(OutputStep), Duration_(Duration)
+	{
+		if (!(OutputStep_ > 0))
+			throw std::logic_error("Output step must be positive");
+	}
+
+	void open(std::size_t ExpectedStates) override
+	{
+		Next_ = 0;
+		HasPrevious_ = false;
+		Downstream_.open(getLastIndex() + 1);
+		TrajectorySink<T, Dim>::Done_ = false;
+	}
+
+	void push(const Coordinates<T, Dim> &State) override
+	{
+		Coordinates<T, Dim> Derivative = Equation_.getDerivative(State);
+		if (!HasPrevious_)
+			Start_ = State[0];
+		for (T Time = getOutputTime(); Time <= State[0]; Time = getOutputTime(++Next_))
+			Downstream_.push(Time == State[0] ? State : interpolateHermite<T, Dim>(Previous_, PreviousDerivative_, State, Derivative, Time));
+		Previous_           = State;
+		PreviousDerivative_ = Derivative;
+		HasPrevious_        = true;
+		TrajectorySink<T, Dim>::Done_ = Downstream_.done();
+	}
+
+	/**
+	 * @brief pushEnd - the output times up to t0 + Duration_ are interpolated in the last step, that ends in the State at the Stop.
+	 *                  The last time may be a rounding after the State, then it is extrapolated by the rounding.
+	 */
+	void pushEnd(const Coordinates<T, Dim> &State) override
+	{
+		if (!HasPrevious_ || !(Duration_ > 0))
+			return;
+		Coordinates<T, Dim> Derivative = Equation_.getDerivative(State);
+		for (; Next_ <= getLastIndex() && !Downstream_.done(); ++Next_)
+		{
+			T Time = getOutputTime();
+			Downstream_.push(Time == State[0] ? State : interpolateHermite<T, Dim>(Previous_, PreviousDerivative_, State, Derivative, Time));
+		}
+	}
+
+	void close() override { Downstream_.close(); }
+
+private:
+	std::size_t getLastIndex() const { return std::size_t(std::max(Duration_, T(0)) / OutputStep_); }
+	T getOutputTime(std::size_t k) const { return Start_ + k * OutputStep_; }
+	T getOutputTime() const { return getOutputTime(Next_); }
+};
+
+//--------------------------------------------------EventSink----------------------------------------------------------------------
+
+/**
+ * @brief struct EventFunction - the event happens, when the Function of the state crosses zero
+ */
+template <typename T, unsigned Dim>
+struct EventFunction
+{
+	std::function<T(const Coordinates<T, Dim>&)> Function;
+	// 1 - only the crossings from below, -1 - only from above, 0 - both
+	int Direction = 0;
+	// The integration stops after TerminateAfter events of this function, never if 0
+	std::size_t TerminateAfter = 0;
+};
+
+/**
+ * @brief class EventSink - finds the events of the Events functions between the pushed states and passes them 
+ *                          to the Downstream sink as the records {state at the event, index of the event function}
+ *                          in the order of time. A sign change of a function between two states is located 
+ *                          by the Illinois method on the interpolateHermite of the states, so the event times
+ *                          have the accuracy of the solver, not of its step. A sign change inside one step,
+ *                          that returns before its end (two roots), isn't noticed.
+ *                          A push costs one derivative evaluation and the evaluations of the event functions.
+ */
+template <typename T, unsigned Dim>
+class EventSink : public TrajectorySink<T, Dim>
+{
+	static constexpr unsigned MaxIterations = 64;
+
+	TrajectorySink<T, Dim + 1> &Downstream_;
+	const DiffEquation<T, Dim> &Equation_;
+	std::vector<EventFunction<T, Dim>> Events_;
+	// Values of the event functions in the previous state
+	std::vector<T> Values_;
+	std::vector<std::size_t> Counts_;
+	// Events found in the last step: time and index of the event function
+	std::vector<std::pair<T, std::size_t>> Found_;
+	bool HasPrevious_ = false;
+	Coordinates<T, Dim> Previous_, PreviousDerivative_;
+
+public:
+	EventSink(TrajectorySink<T, Dim + 1> &Downstream, const DiffEquation<T, Dim> &Equation, std::vector<EventFunction<T, Dim>> Events) : 
+	Downstream_(Downstream), Equation_(Equation), Events_(std::move(Events)), Values_(Events_.size()), Counts_(Events_.size())
+	{
+		for (const EventFunction<T, Dim> &Event : Events_)
+			if (!Event.Function || Event.Direction < -1 || Event.Direction > 1)
+				throw std::logic_error("Event must have a function and the direction -1, 0 or 1");
+	}
+
+	void open(std::size_t ExpectedStates) override
+	{
+		HasPrevious_ = false;
+		std::fill(Counts_.begin(), Counts_.end(), 0);
+		Downstream_.open(0);
+		TrajectorySink<T, Dim>::Done_ = false;
+	}
+
+	void push(const Coordinates<T, Dim> &State) override
+	{
+		Coordinates<T, Dim> Derivative = Equation_.getDerivative(State);
+		Found_.clear();
+		for (std::size_t i = 0; i < Events_.size(); ++i)
+		{
+			T Value = Events_[i].Function(State);
+			if (HasPrevious_ && isCrossing(Values_[i], Value, Events_[i].Direction))
+				Found_.emplace_back(findRoot(Events_[i], Values_[i], Value, State, Derivative), i);
+			Values_[i] = Value;
+		}
+		std::sort(Found_.begin(), Found_.end());
+		for (const auto &[Time, Index] : Found_)
+		{
+			Coordinates<T, Dim> Y = Time == State[0] ? State : interpolateHermite<T, Dim>(Previous_, PreviousDerivative_, State, Derivative, Time);
+			Coordinates<T, Dim + 1> Record;
+			for (unsigned j = 0; j < Dim; ++j)
+				Record[j] = Y[j];
+			Record[Dim] = T(Index);
+			Downstream_.push(Record);
+			if (Events_[Index].TerminateAfter > 0 && ++Counts_[Index] >= Events_[Index].TerminateAfter)
+			{
+				TrajectorySink<T, Dim>::Done_ = true;
+				break;
+			}
+		}
+		Previous_           = State;
+		PreviousDerivative_ = Derivative;
+		HasPrevious_        = true;
+		TrajectorySink<T, Dim>::Done_ = TrajectorySink<T, Dim>::Done_ || Downstream_.done();
+	}
+
+	void close() override { Downstream_.close(); }
+
+private:
+	// A zero in the previous state was counted in the previous step
+	static bool isCrossing(T Previous, T Value, int Direction)
+	{
+		bool Rising  = (Previous < 0) && (Value >= 0);
+		bool Falling = (Previous > 0) && (Value <= 0);
+		return Direction > 0 ? Rising : Direction < 0 ? Falling : Rising || Falling;
+	}
+
+	T findRoot(const EventFunction<T, Dim> &Event, T G0, T G1, const Coordinates<T, Dim> &State, const Coordinates<T, Dim> &Derivative) const
+	{
+		T A = Previous_[0], B = State[0];
+		if (G1 == 0)
+			return B;
+		const T Tolerance = 4 * std::numeric_limits<T>::epsilon() * std::max(std::abs(B), T(1));
+		// Side of the last moved end: 1 - B, -1 - A. If the same end moves twice, the value of the other one is halved (Illinois)
+		int Side = 0;
+		for (unsigned Iteration = 0; Iteration < MaxIterations && B - A > Tolerance; ++Iteration)
+		{
+			T C = (A * G1 - B * G0) / (G1 - G0);
+			T G = Event.Function(interpolateHermite<T, Dim>(Previous_, PreviousDerivative_, State, Derivative, C));
+			if (G == 0)
+				return C;
+			if ((G < 0) == (G1 < 0))
+			{
+				B = C, G1 = G;
+				if (Side == 1)
+					G0 /= 2;
+				Side = 1;
+			}
+			else
+			{
+				A = C, G0 = G;
+				if (Side == -1)
+					G1 /= 2;
+				Side = -1;
+			}
+		}
+		return (A * G1 - B * G0) / (G1 - G0);
+	}
+};
+
+//---------------------------------------------------TeeSink-----------------------------------------------------------------------
+
+/**
+ * @brief class TeeSink - passes every state to both the First and the Second sinks
+ */
+template <typename T, unsigned Dim>
+class TeeSink : public TrajectorySink<T, Dim>
+{
+	TrajectorySink<T, Dim> &First_;
+	TrajectorySink<T, Dim> &Second_;
+
+public:
+	TeeSink(TrajectorySink<T, Dim> &First, TrajectorySink<T, Dim> &Second) : First_(First), Second_(Second) {};
+
+	void open(std::size_t ExpectedStates) override
+	{
+		First_.open(ExpectedStates);
+		Second_.open(ExpectedStates);
+		TrajectorySink<T, Dim>::Done_ = false;
+	}
+
+	void push(const Coordinates<T, Dim> &State) override
+	{
+		First_.push(State);
+		Second_.push(State);
+		TrajectorySink<T, Dim>::Done_ = First_.done() || Second_.done();
+	}
+
+	void pushEnd(const Coordinates<T, Dim> &State) override
+	{
+		First_.pushEnd(State);
+		Second_.pushEnd(State);
+	}
+
+	void close() override
+	{
+		First_.close();
+		Second_.close();
+	}
+};
+
+
+#endif // TRAJECTORY_SINK_H